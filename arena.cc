@@ -0,0 +1,227 @@
+/*
+ * arena module
+ *
+ * This module contains a bump allocator over one region of memory that is
+ * mapped and faulted in once, up front. Stages take aligned buffers from it
+ * with arena_alloc and friends, and the whole arena is reset between stages
+ * instead of freeing buffer by buffer, so the timed regions of the protocol
+ * neither call malloc for their large buffers nor touch freshly mapped
+ * pages.
+ *
+ * The size of the arena is computed from the architecture by the callers:
+ * arena_bytes, arena_words_bytes and arena_table_bytes give the footprint of
+ * each kind of allocation, including alignment padding.
+ *
+ * An arena may instead be backed by a spill file (arena_init_file), for the
+ * tensors of networks larger than memory: its pages are faulted in on first
+ * use and written back to the file, rather than to swap, under memory
+ * pressure.
+ */
+#include "arena.h"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+ * arena_bytes:
+ *    returns the footprint of an allocation of the given number of bytes.
+ */
+size_t arena_bytes(size_t bytes)
+{
+    return (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/*
+ * arena_words_bytes:
+ *    returns the footprint of an allocation of n field elements.
+ */
+size_t arena_words_bytes(uint64 n)
+{
+    return arena_bytes(n*sizeof(uint64));
+}
+
+/*
+ * arena_table_bytes:
+ *    returns the footprint of arena_table(rows, cols).
+ */
+size_t arena_table_bytes(uint64 rows, uint64 cols)
+{
+    return arena_bytes(rows*sizeof(uint64*)) + arena_words_bytes(rows*cols);
+}
+
+/*
+ * arena_init:
+ *    maps an arena of (at least) size bytes, with all its pages faulted in.
+ *
+ * Params:
+ *    arena* a: the arena to initialize
+ *    size_t size: the capacity in bytes
+ *
+ * Returns:
+ *    Nothing. Exits if the memory cannot be mapped.
+ */
+void arena_init(arena* a, size_t size)
+{
+    a->size = arena_bytes(size > 0 ? size : 1);
+    a->used = 0;
+    a->peak = 0;
+    void* base = mmap(NULL, a->size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (base == MAP_FAILED)
+        cout << "could not map an arena of " << a->size << " bytes" << endl,
+             exit(1);
+    a->base = (char*) base;
+}
+
+/*
+ * arena_init_file:
+ *    maps an arena of (at least) size bytes backed by a spill file in the
+ *    directory dir. The file is unlinked at once, so it goes away with the
+ *    mapping; nothing is faulted in up front.
+ *
+ * Params:
+ *    arena* a: the arena to initialize
+ *    size_t size: the capacity in bytes
+ *    const char* dir: the directory of the spill file
+ *
+ * Returns:
+ *    Nothing. Exits if the file cannot be created or mapped.
+ */
+void arena_init_file(arena* a, size_t size, const char* dir)
+{
+    a->size = arena_bytes(size > 0 ? size : 1);
+    a->used = 0;
+    a->peak = 0;
+    string path = string(dir) + "/safetynets-spill-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0)
+        cout << "could not create a spill file in " << dir << endl, exit(1);
+    unlink(path.c_str());
+    if (ftruncate(fd, a->size) != 0)
+        cout << "could not size the spill file to " << a->size << " bytes"
+             << endl, exit(1);
+    void* base = mmap(NULL, a->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+            0);
+    close(fd);
+    if (base == MAP_FAILED)
+        cout << "could not map a spill file of " << a->size << " bytes" << endl,
+             exit(1);
+    a->base = (char*) base;
+}
+
+/*
+ * arena_sequential:
+ *    tells the kernel whether the buffer of bytes bytes at p is about to be
+ *    read once, in order, so that it reads ahead of a streaming pass over a
+ *    spilled or mapped tensor and drops its pages behind it. Only a hint:
+ *    nothing is done on failure.
+ */
+void arena_sequential(const void* p, size_t bytes, bool on)
+{
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t b = (uintptr_t) p & ~(page - 1);
+    uintptr_t e = (uintptr_t) p + bytes;
+    if (e > b)
+        madvise((void*) b, e - b, on ? MADV_SEQUENTIAL : MADV_NORMAL);
+}
+
+/*
+ * arena_destroy:
+ *    unmaps the arena (and drops its spill file, if any).
+ */
+void arena_destroy(arena* a)
+{
+    munmap(a->base, a->size);
+    a->base = NULL;
+    a->size = a->used = 0;
+}
+
+/*
+ * arena_alloc:
+ *    hands out an uninitialized, ARENA_ALIGN-aligned buffer.
+ *
+ * Params:
+ *    arena* a: the arena
+ *    size_t bytes: the size of the buffer
+ *
+ * Returns:
+ *    void*: the buffer. Exits if the arena is exhausted, which means its
+ *           size was computed wrong.
+ */
+void* arena_alloc(arena* a, size_t bytes)
+{
+    size_t need = arena_bytes(bytes);
+    if (a->used + need > a->size)
+        cout << "arena exhausted: " << a->used << " + " << need << " > "
+             << a->size << " bytes" << endl, exit(1);
+    void* buf = a->base + a->used;
+    a->used += need;
+    if (a->used > a->peak)
+        a->peak = a->used;
+    return buf;
+}
+
+/*
+ * arena_words:
+ *    hands out an uninitialized buffer of n field elements.
+ */
+uint64* arena_words(arena* a, uint64 n)
+{
+    return (uint64*) arena_alloc(a, n*sizeof(uint64));
+}
+
+/*
+ * arena_zeros:
+ *    hands out a zeroed buffer of n field elements.
+ */
+uint64* arena_zeros(arena* a, uint64 n)
+{
+    uint64* buf = arena_words(a, n);
+    for (uint64 i = 0; i < n; i++)
+        buf[i] = 0;
+    return buf;
+}
+
+/*
+ * arena_table:
+ *    hands out a zeroed rows x cols table, such as the round polynomials F
+ *    of a sum-check, as an array of row pointers into one block.
+ */
+uint64** arena_table(arena* a, uint64 rows, uint64 cols)
+{
+    uint64** table = (uint64**) arena_alloc(a, rows*sizeof(uint64*));
+    uint64* block = arena_zeros(a, rows*cols);
+    for (uint64 i = 0; i < rows; i++)
+        table[i] = block + i*cols;
+    return table;
+}
+
+/*
+ * arena_mark / arena_release:
+ *    arena_release(a, arena_mark(a)) frees everything allocated in between,
+ *    for scratch that only lives during one call.
+ */
+size_t arena_mark(arena* a)
+{
+    return a->used;
+}
+
+void arena_release(arena* a, size_t mark)
+{
+    a->used = mark;
+}
+
+/*
+ * arena_reset:
+ *    frees every buffer of the arena at once.
+ */
+void arena_reset(arena* a)
+{
+    a->used = 0;
+}
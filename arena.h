@@ -0,0 +1,40 @@
+/*
+ * arena module header file
+ *
+ * This module contains the scratch arena the protocol stages allocate their
+ * buffers from, so that a whole network proof maps its memory once.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+
+#include "math.h"
+
+// alignment of every buffer handed out, one cache line
+#define ARENA_ALIGN 64
+
+struct arena {
+    char* base;
+    size_t size;
+    size_t used;
+    size_t peak;
+};
+
+/* for information on these functions, read arena.cc */
+size_t arena_bytes(size_t bytes);
+size_t arena_words_bytes(uint64 n);
+size_t arena_table_bytes(uint64 rows, uint64 cols);
+void arena_init(arena* a, size_t size);
+void arena_init_file(arena* a, size_t size, const char* dir);
+void arena_sequential(const void* p, size_t bytes, bool on);
+void arena_destroy(arena* a);
+void* arena_alloc(arena* a, size_t bytes);
+uint64* arena_words(arena* a, uint64 n);
+uint64* arena_zeros(arena* a, uint64 n);
+uint64** arena_table(arena* a, uint64 rows, uint64 cols);
+size_t arena_mark(arena* a);
+void arena_release(arena* a, size_t mark);
+void arena_reset(arena* a);
+
+#endif // ARENA_H
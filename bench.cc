@@ -0,0 +1,464 @@
+/* bench:
+ *
+ *  Benchmarks of the field arithmetic and of the sum-check kernels of the
+ *  prover at swept sizes, and a sweep of the whole proof over synthetic
+ *  fully connected networks, charting the additional prover time against
+ *  the (unverifiable) time of the inference.
+ *
+ *  Every benchmark runs warmup times untimed, then reps times, each run on
+ *  fresh inputs drawn from a fixed seed (the preparation of the inputs is
+ *  not timed), and reports the minimum, median, mean and relative standard
+ *  deviation of the runs and the throughput at the median.
+ *
+ * Licensing:
+ *  This work is licensed under CC BY-NC-SA 3.0. Refer to the licesne file for
+ *  more information.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+#include "arena.h"
+#include "kernels.h"
+#include "math.h"
+#include "mle.h"
+#include "model.h"
+#include "poly.h"
+#include "proof.h"
+#include "prover.h"
+#include "threadpool.h"
+#include "transcript.h"
+#include "safetynets.h"
+#include "util.h"
+
+using namespace std;
+
+// the settings of a run of the benchmarks (see main)
+struct bench_config {
+    int warmup;
+    int reps;
+    uint64 seed;
+    int lo, hi;
+    uint64 ops;
+    int max_batch, max_width, depth;
+    size_t budget;
+    FILE* csv;
+};
+
+/*
+ * fill_random:
+ *    fills V with n canonical field elements drawn from state.
+ */
+static void fill_random(uint64* V, uint64 n, uint64* state)
+{
+    for (uint64 k = 0; k < n; k++)
+        V[k] = model_rand(state) % PRIME;
+}
+
+/*
+ * bench_run:
+ *    runs the benchmark name of size size: setup, then body, warmup + reps
+ *    times, timing body alone, and prints (and writes to the CSV file) the
+ *    statistics of the timed runs. work is the number of units (of the
+ *    given name) body processes, for the throughput.
+ */
+static void bench_run(bench_config* cfg, const char* name, uint64 size,
+        double work, const char* unit, const function<void()>& setup,
+        const function<void()>& body)
+{
+    vector<double> times;
+    for (int i = 0; i < cfg->warmup + cfg->reps; i++)
+    {
+        setup();
+        double t = wall_time();
+        body();
+        t = wall_time() - t;
+        if (i >= cfg->warmup)
+            times.push_back(t);
+    }
+
+    sort(times.begin(), times.end());
+    int n = times.size();
+    double median = (n & 1) ? times[n/2] : (times[n/2-1] + times[n/2])/2;
+    double mean = 0, var = 0;
+    for (int i = 0; i < n; i++)
+        mean += times[i];
+    mean /= n;
+    for (int i = 0; i < n; i++)
+        var += (times[i] - mean)*(times[i] - mean);
+    double rsd = (n > 1 && mean > 0) ? sqrt(var/(n-1))/mean*100 : 0;
+    double rate = work/median;
+
+    printf("%-28s %12llu %12.6f %12.6f %12.6f %7.2f%% %12.2f M%s/s\n", name,
+           (unsigned long long) size, times[0]*1e3, median*1e3, mean*1e3,
+           rsd, rate*1e-6, unit);
+    fflush(stdout);
+    if (cfg->csv)
+        fprintf(cfg->csv, "%s,%llu,%d,%.9g,%.9g,%.9g,%.9g,%.9g,%s\n", name,
+                (unsigned long long) size, n, times[0], median, mean, rsd,
+                rate, unit);
+}
+
+/*
+ * bench_field:
+ *    benchmarks the scalar field operations: chains of dependent myModMult
+ *    (latency rather than throughput), myModPow with full-size exponents,
+ *    inv, and the extrapolation of round polynomials of 3 and 4
+ *    evaluations (the degrees the protocol uses).
+ */
+static void bench_field(bench_config* cfg)
+{
+    uint64 ops = cfg->ops;
+    uint64 state = cfg->seed;
+    vector<uint64> x(ops/16 + 4);
+    volatile uint64 sink;
+
+    bench_run(cfg, "myModMult", ops, ops, "op",
+        [&]() { state = cfg->seed; },
+        [&]() {
+            uint64 a = model_rand(&state) % PRIME;
+            uint64 b = model_rand(&state) % PRIME;
+            for (uint64 k = 0; k < ops; k++)
+                a = myModMult(a, b);
+            sink = a;
+        });
+
+    uint64 pows = ops/64;
+    bench_run(cfg, "myModPow", pows, pows, "op",
+        [&]() { fill_random(x.data(), pows, &state); },
+        [&]() {
+            uint64 a = 0;
+            for (uint64 k = 0; k < pows; k++)
+                a ^= myModPow(x[k] | 1, x[k] ^ a);
+            sink = a;
+        });
+
+    bench_run(cfg, "inv", pows, pows, "op",
+        [&]() { fill_random(x.data(), pows, &state); },
+        [&]() {
+            uint64 a = 0;
+            for (uint64 k = 0; k < pows; k++)
+                a ^= inv(x[k] ^ (a & 1));
+            sink = a;
+        });
+
+    uint64 calls = ops/16;
+    for (uint64 n = 3; n <= 4; n++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "extrap/%llu", (unsigned long long) n);
+        bench_run(cfg, name, calls, calls, "op",
+            [&]() { fill_random(x.data(), calls + n, &state); },
+            [&]() {
+                uint64 a = 0;
+                for (uint64 k = 0; k < calls; k++)
+                    a ^= extrap(&x[k], n, x[k+1] ^ (a & 1));
+                sink = a;
+            });
+    }
+    (void) sink;
+}
+
+/*
+ * bench_kernels:
+ *    benchmarks the folding and MLE kernels and the sum-checks of the
+ *    stages on tables of 2^d entries, for d from cfg->lo to cfg->hi in
+ *    steps of 2. The sum-checks draw their challenges from a fresh
+ *    transcript every run.
+ */
+static void bench_kernels(bench_config* cfg)
+{
+    uint64 state = cfg->seed;
+    uint64 nmax = myPow(2, cfg->hi);
+    int dmax = cfg->hi;
+
+    uint64* A = new uint64[nmax];
+    uint64* B = new uint64[nmax];
+    uint64* A0 = new uint64[nmax];
+    uint64* B0 = new uint64[nmax];
+    uint64* Iin = new uint64[nmax];
+    uint64* I_t = new uint64[nmax/2 + 1];
+    uint64* V_t = new uint64[nmax/2 + 1];
+    uint64* r = new uint64[dmax];
+    uint64* q = new uint64[dmax];
+    uint64* F = new uint64[4*dmax + 1];
+    uint64 rho = 1;
+    fill_random(A0, nmax, &state);
+    fill_random(B0, nmax, &state);
+
+    // scratch of the MLE, check_bias_layer and the sum-checks
+    arena scratch;
+    arena_init(&scratch, arena_words_bytes(nmax) +
+            2*arena_words_bytes(nmax/4 + 1) +
+            arena_words_bytes(4*threadpool_size()) + round_sums_bytes() +
+            mle_scratch_bytes(0, dmax, 1));
+    transcript tr;
+
+    for (int d = cfg->lo; d <= cfg->hi; d += 2)
+    {
+        uint64 n = myPow(2, d);
+        uint64 p = myPow(2, d/2);
+        char name[64];
+
+        snprintf(name, sizeof(name), "updateV/%d", d);
+        bench_run(cfg, name, n, n, "elem",
+            [&]() {
+                copy(A0, A0 + n, A);
+                fill_random(r, 1, &state);
+            },
+            [&]() { updateV(A, n/2, r[0]); });
+
+        snprintf(name, sizeof(name), "evaluate_V_i/%d", d);
+        bench_run(cfg, name, n, n, "elem",
+            [&]() {
+                fill_random(r, d, &state);
+                arena_reset(&scratch);
+            },
+            [&]() { evaluate_V_i(d, n, A0, r, &scratch); });
+
+        snprintf(name, sizeof(name), "sum_check_mm/%d", d);
+        bench_run(cfg, name, n, n, "elem",
+            [&]() {
+                copy(A0, A0 + n, A);
+                copy(B0, B0 + n, B);
+                transcript_init(&tr, "bench");
+                arena_reset(&scratch);
+            },
+            [&]() { sum_check_mm(A, B, d, 0, 0, r, F, q, &tr, &scratch); });
+
+        snprintf(name, sizeof(name), "sum_check_bias_sqr_activation/%d", d);
+        bench_run(cfg, name, n, n, "elem",
+            [&]() {
+                fill_random(q, d, &state);
+                transcript_init(&tr, "bench");
+                arena_reset(&scratch);
+            },
+            [&]() {
+                sum_check_bias_sqr_activation(q, r, d, n, Iin, I_t, 1, A0,
+                        NULL, p, p, &rho, V_t, F, F + 4*d, &tr, &scratch);
+            });
+
+        snprintf(name, sizeof(name), "check_bias_layer/%d", d);
+        bench_run(cfg, name, n, n, "elem",
+            [&]() {
+                fill_random(q, d, &state);
+                transcript_init(&tr, "bench");
+                arena_reset(&scratch);
+            },
+            [&]() {
+                check_bias_layer(q, r, d, n, p, p, Iin, A0, B0, F, &tr,
+                        &scratch);
+            });
+    }
+
+    arena_destroy(&scratch);
+    delete[] A;
+    delete[] B;
+    delete[] A0;
+    delete[] B0;
+    delete[] Iin;
+    delete[] I_t;
+    delete[] V_t;
+    delete[] r;
+    delete[] q;
+    delete[] F;
+}
+
+/*
+ * bench_sweep:
+ *    runs the inference and the proof of synthetic fully connected networks
+ *    of cfg->depth layers of width neurons on a batch of batch samples, for
+ *    batches from 1 to cfg->max_batch (by factors of 4) and widths from 256
+ *    to cfg->max_width (by factors of 2), and reports the median
+ *    unverifiable and additional prover times and their ratio. Networks
+ *    whose tensors and scratch exceed cfg->budget bytes are skipped.
+ */
+static void bench_sweep(bench_config* cfg)
+{
+    printf("%8s %8s %6s %14s %14s %10s %12s %12s\n", "batch", "width",
+           "depth", "unverifiable", "prover", "overhead", "proof bytes",
+           "peak bytes");
+    if (cfg->csv)
+        fprintf(cfg->csv, "batch,width,depth,unverifiable,prover,overhead,"
+                "proof_bytes,peak_bytes\n");
+
+    // the stages report their times as they go; the sweep only keeps the
+    // totals
+    ofstream quiet("/dev/null");
+    for (int batch = 1; batch <= cfg->max_batch; batch *= 4)
+        for (int width = 256; width <= cfg->max_width; width *= 2)
+        {
+            vector<int*> layers;
+            for (int i = 0; i < cfg->depth; i++)
+            {
+                int* n = new int[8];
+                n[0] = ceil(log2(batch));
+                n[1] = n[2] = ceil(log2(width));
+                n[3] = n[4] = width;
+                n[5] = n[6] = n[7] = 0;
+                layers.push_back(n);
+            }
+            int L = layers.size();
+            uint64 out_words = myPow(2, layers[L-1][0] + layers[L-1][2]);
+            size_t net_bytes = model_bytes(layers, 1, true, NULL) +
+                               arena_words_bytes(out_words);
+            size_t mem_bytes = prover_footprint(layers, 1, 0);
+
+            if (net_bytes + mem_bytes > cfg->budget)
+            {
+                printf("%8d %8d %6d %14s\n", batch, width, cfg->depth,
+                       "skipped");
+                for (int i = 0; i < L; i++)
+                    delete[] layers[i];
+                continue;
+            }
+
+            arena net_mem, mem;
+            arena_init(&net_mem, net_bytes);
+            arena_init(&mem, mem_bytes);
+            vector<layer> net;
+            model_init(net, layers, 1, true, NULL, &net_mem);
+            uint64* out = arena_words(&net_mem, out_words);
+
+            vector<double> ut, pt;
+            uint64 proof_bytes = 0;
+            for (int i = 0; i < cfg->warmup + cfg->reps; i++)
+            {
+                streambuf* saved = cout.rdbuf(quiet.rdbuf());
+                arena_reset(&mem);
+                runtime f = forward(net, 1, out, &mem);
+                proof_stream ps;
+                proof_open(&ps, "/dev/null", true);
+                arena_reset(&mem);
+                runtime p = prove_network(net, 1, false, out, -1, &ps,
+                        &mem);
+                proof_close(&ps);
+                cout.rdbuf(saved);
+                proof_bytes = ps.bytes;
+                if (i >= cfg->warmup)
+                {
+                    ut.push_back(f.unverifiable);
+                    pt.push_back(p.prover);
+                }
+            }
+            sort(ut.begin(), ut.end());
+            sort(pt.begin(), pt.end());
+            double u = ut[ut.size()/2];
+            double p = pt[pt.size()/2];
+
+            printf("%8d %8d %6d %14.6f %14.6f %10.4f %12llu %12zu\n", batch,
+                   width, cfg->depth, u, p, p/u,
+                   (unsigned long long) proof_bytes, mem.peak);
+            fflush(stdout);
+            if (cfg->csv)
+                fprintf(cfg->csv, "%d,%d,%d,%.9g,%.9g,%.9g,%llu,%zu\n",
+                        batch, width, cfg->depth, u, p, p/u,
+                        (unsigned long long) proof_bytes, mem.peak);
+
+            arena_destroy(&mem);
+            arena_destroy(&net_mem);
+            for (int i = 0; i < L; i++)
+                delete[] layers[i];
+        }
+}
+
+int main(int argc, char** argv)
+{
+    bench_config cfg;
+    // number of threads of the pool (-t)
+    int num_threads = 1;
+    // untimed and timed runs of every benchmark (-w, -r)
+    cfg.warmup = 1;
+    cfg.reps = 5;
+    // seed of the inputs (-S)
+    cfg.seed = 1;
+    // log sizes of the tables of the kernel benchmarks (-l, -h)
+    cfg.lo = 10;
+    cfg.hi = 20;
+    // operations per run of the scalar benchmarks (-n)
+    cfg.ops = 1 << 22;
+    // largest batch and width (-b, -W), number of layers (-D) and memory
+    // budget in MiB (-M) of the sweep
+    cfg.max_batch = 4096;
+    cfg.max_width = 8192;
+    cfg.depth = 2;
+    cfg.budget = (size_t) 4096 << 20;
+    // CSV file the results are also written to (-o)
+    const char* csv_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:w:r:S:l:h:n:b:W:D:M:o:")) != -1)
+    {
+        if (opt == 't')
+            num_threads = atoi(optarg);
+        else if (opt == 'w')
+            cfg.warmup = atoi(optarg);
+        else if (opt == 'r')
+            cfg.reps = atoi(optarg);
+        else if (opt == 'S')
+            cfg.seed = strtoull(optarg, NULL, 10);
+        else if (opt == 'l')
+            cfg.lo = atoi(optarg);
+        else if (opt == 'h')
+            cfg.hi = atoi(optarg);
+        else if (opt == 'n')
+            cfg.ops = strtoull(optarg, NULL, 10);
+        else if (opt == 'b')
+            cfg.max_batch = atoi(optarg);
+        else if (opt == 'W')
+            cfg.max_width = atoi(optarg);
+        else if (opt == 'D')
+            cfg.depth = atoi(optarg);
+        else if (opt == 'M')
+            cfg.budget = (size_t) atoll(optarg) << 20;
+        else if (opt == 'o')
+            csv_path = optarg;
+        else
+            cout << "Usage: " << argv[0] << " [-t threads] [-w warmup]"
+                 << " [-r reps] [-S seed] [-o csv file]" << endl
+                 << "         [-n ops] [-l min log size] [-h max log size]"
+                 << " [field | kernels | sweep]" << endl
+                 << "         [-b max batch] [-W max width] [-D depth]"
+                 << " [-M budget MiB] sweep" << endl, exit(1);
+    }
+    string mode = (optind < argc) ? argv[optind] : "kernels";
+    if (optind < argc - 1 ||
+        (mode != "field" && mode != "kernels" && mode != "sweep"))
+        cout << "The mode is field, kernels or sweep." << endl, exit(1);
+    if (num_threads < 1 || cfg.warmup < 0 || cfg.reps < 1 || cfg.depth < 1)
+        cout << "The threads, runs and depth must be positive." << endl,
+             exit(1);
+    if (cfg.lo < 2 || cfg.hi < cfg.lo || cfg.hi > 30 || cfg.ops < 64)
+        cout << "The log sizes must be in 2..30 and the ops at least 64."
+             << endl, exit(1);
+
+    threadpool_init(num_threads);
+    printf("kernel path = %s\n", kernels_path());
+    cfg.csv = NULL;
+    if (csv_path)
+    {
+        cfg.csv = fopen(csv_path, "w");
+        if (cfg.csv == NULL)
+            cout << "Cannot write " << csv_path << endl, exit(1);
+    }
+
+    if (mode == "sweep")
+        bench_sweep(&cfg);
+    else
+    {
+        printf("%-28s %12s %12s %12s %12s %8s %16s\n", "benchmark", "size",
+               "min ms", "median ms", "mean ms", "rsd", "throughput");
+        if (cfg.csv)
+            fprintf(cfg.csv, "name,size,reps,min,median,mean,rsd,rate,"
+                    "unit\n");
+        bench_field(&cfg);
+        if (mode == "kernels")
+            bench_kernels(&cfg);
+    }
+
+    if (cfg.csv)
+        fclose(cfg.csv);
+    threadpool_shutdown();
+
+    return 0;
+}
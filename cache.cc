@@ -0,0 +1,307 @@
+/*
+ * cache module
+ *
+ * This module contains the verifier's preprocessing cache. A cache holds a
+ * number of sessions, each the coins of one proof followed by the
+ * evaluations the verifier needs at the points those coins lead to: for
+ * every layer, from the output layer down, the MLE of its weights and of its
+ * bias. The coins are drawn from a secret seed and never leave the
+ * verifier's process but one at a time, each once the prover is bound to
+ * the messages before it (see channel.cc); a session is only used once, as
+ * the prover sees its coins as the proof goes on.
+ *
+ * Coins are consumed in the order of the protocol (see verifier.cc): the
+ * batch coefficients (if there are several batches), the point of the
+ * output claim, then the rounds of every stage, top layer first.
+ */
+#include <iostream>
+#include <sys/file.h>
+
+#include "cache.h"
+#include "conv.h"
+#include "mle.h"
+#include "transcript.h"
+
+using namespace std;
+
+/*
+ * cache_coins:
+ *    returns the number of coins of a proof about net.
+ */
+uint64 cache_coins(vector<layer>& net, int batches, bool separate)
+{
+    int L = net.size();
+    uint64 coins = (batches > 1) ? batches : 0;
+    coins += net[L-1].e + net[L-1].f;
+    for (int i = L-1; i >= 0; i--)
+    {
+        int d = net[i].e + net[i].f;
+        if (i != L-1)
+            coins += d;             // (bias and) sqr activation
+        if (i == L-1 || separate)
+            coins += d;             // bias
+        if (net[i].k)               // convolution: kernel, then input
+            coins += conv_weight_vars(net[i].d, net[i].k, net[i].h,
+                                      net[i].w) + net[i].e + net[i].d;
+        else
+            coins += net[i].d;      // matrix-matrix mult
+    }
+    return coins;
+}
+
+/*
+ * cache_session_words:
+ *    returns the number of words of a session: its coins and two
+ *    evaluations per layer.
+ */
+uint64 cache_session_words(vector<layer>& net, int batches, bool separate)
+{
+    return cache_coins(net, batches, separate) + 2*net.size();
+}
+
+/*
+ * session_points:
+ *    follows the claims of a proof through the coins of a session and
+ *    fills in, for every layer, the point its weights (d+f coordinates) and
+ *    its bias (f coordinates) are evaluated at.
+ */
+static void session_points(vector<layer>& net, int batches, bool separate,
+        const uint64* coins, vector<vector<uint64> >& w_points,
+        vector<vector<uint64> >& b_points)
+{
+    int L = net.size();
+    uint64 next = (batches > 1) ? batches : 0;
+    vector<uint64> point(coins + next,
+            coins + next + net[L-1].e + net[L-1].f);
+    next += point.size();
+
+    for (int i = L-1; i >= 0; i--)
+    {
+        layer* l = &net[i];
+        int d = l->e + l->f;
+        vector<uint64> r(d);
+
+        // the sqr activation binds low-order variables first, the bias and
+        // the matrix-matrix mult high-order first
+        if (i != L-1)
+        {
+            for (int j = 0; j < d; j++)
+                r[j] = coins[next + j];
+            next += d;
+            point = r;
+        }
+        if (i == L-1 || separate)
+        {
+            for (int j = 0; j < d; j++)
+                r[d-1-j] = coins[next + j];
+            next += d;
+            point = r;
+        }
+        b_points[i].assign(point.begin(), point.begin() + l->f);
+
+        // a convolution binds the kernel index, then all the input
+        // variables; its kernel has a row per output channel
+        if (l->k)
+        {
+            int kd = conv_weight_vars(l->d, l->k, l->h, l->w);
+            vector<uint64> r_k(kd);
+            for (int j = 0; j < kd; j++)
+                r_k[kd-1-j] = coins[next + j];
+            next += kd;
+            w_points[i] = r_k;
+            w_points[i].insert(w_points[i].end(),
+                    point.begin() + l->h + l->w, point.begin() + l->f);
+            vector<uint64> below(l->e + l->d);
+            for (int j = 0; j < l->e + l->d; j++)
+                below[l->e + l->d-1-j] = coins[next + j];
+            next += l->e + l->d;
+            point = below;
+            continue;
+        }
+
+        vector<uint64> r_mm(l->d);
+        for (int j = 0; j < l->d; j++)
+            r_mm[l->d-1-j] = coins[next + j];
+        next += l->d;
+
+        w_points[i] = r_mm;
+        w_points[i].insert(w_points[i].end(), point.begin(),
+                point.begin() + l->f);
+        vector<uint64> below = r_mm;
+        below.insert(below.end(), point.begin() + l->f, point.end());
+        point = below;
+    }
+}
+
+/*
+ * cache_build:
+ *    preprocesses sessions proofs about net into the cache file at path.
+ *    The weights of every layer are read once for all the sessions.
+ *
+ * Params:
+ *    const char* path: the cache file, replaced
+ *    vector<layer>& net: the network (weights and biases)
+ *    int batches: the number of batches of the proofs
+ *    bool separate: the proofs prove bias and sqr activation separately
+ *    int sessions: the number of proofs to preprocess
+ *
+ * Returns:
+ *    Nothing. Exits if the cache cannot be written.
+ */
+void cache_build(const char* path, vector<layer>& net, int batches,
+        bool separate, int sessions)
+{
+    int L = net.size();
+    uint64 coins = cache_coins(net, batches, separate);
+    uint64 words = cache_session_words(net, batches, separate);
+    vector<uint64> cache(sessions*words);
+
+    // the coins are drawn from a secret seed
+    uint64 seed[4];
+    FILE* urandom = fopen("/dev/urandom", "rb");
+    if (urandom == NULL || fread(seed, sizeof(seed), 1, urandom) != 1)
+        cout << "Cannot read /dev/urandom" << endl, exit(1);
+    fclose(urandom);
+    transcript tr;
+    transcript_init(&tr, "safetynets coins");
+    transcript_absorb(&tr, seed, 4);
+    for (int s = 0; s < sessions; s++)
+        transcript_challenges(&tr, &cache[s*words], coins);
+
+    vector<vector<vector<uint64> > > w_points(sessions,
+            vector<vector<uint64> >(L));
+    vector<vector<vector<uint64> > > b_points(sessions,
+            vector<vector<uint64> >(L));
+    for (int s = 0; s < sessions; s++)
+        session_points(net, batches, separate, &cache[s*words], w_points[s],
+                b_points[s]);
+
+    // the eq tables of the evaluations of the largest layer
+    size_t scratch_bytes = 0;
+    for (int i = 0; i < L; i++)
+    {
+        layer* l = &net[i];
+        int hw = l->h + l->w;
+        scratch_bytes = max(scratch_bytes, l->k ?
+                mle_scratch_bytes(l->f - hw,
+                    conv_weight_vars(l->d, l->k, l->h, l->w), sessions) :
+                mle_scratch_bytes(l->f, l->d, sessions));
+        scratch_bytes = max(scratch_bytes, mle_scratch_bytes(0, l->f, 1));
+    }
+    arena scratch;
+    arena_init(&scratch, scratch_bytes);
+
+    // evaluations are stored top layer first, in the order they are used
+    vector<uint64> evals(sessions);
+    for (int i = L-1; i >= 0; i--)
+    {
+        layer* l = &net[i];
+        vector<const void*> levels(sessions, l->W);
+        vector<uint64*> points(sessions);
+        for (int s = 0; s < sessions; s++)
+            points[s] = w_points[s][i].data();
+        if (l->k)
+        {
+            int hw = l->h + l->w;
+            int kd = conv_weight_vars(l->d, l->k, l->h, l->w);
+            evaluate_matrix_multi(l->f - hw, kd, l->p_true >> hw,
+                    myPow(2, kd), levels.data(), l->Wtype, points.data(),
+                    sessions, evals.data(), &scratch);
+        }
+        else
+            evaluate_matrix_multi(l->f, l->d, l->p_true, l->n_true,
+                    levels.data(), l->Wtype, points.data(), sessions,
+                    evals.data(), &scratch);
+
+        uint64 slot = coins + 2*(L-1-i);
+        for (int s = 0; s < sessions; s++)
+        {
+            cache[s*words + slot] = evals[s];
+            cache[s*words + slot + 1] = evaluate_V_i(l->f, l->p_true, l->b,
+                    b_points[s][i].data(), &scratch);
+        }
+    }
+    arena_destroy(&scratch);
+
+    vector<uint64> header(CACHE_HEADER_WORDS(L));
+    header[0] = CACHE_MAGIC;
+    header[1] = L;
+    header[2] = batches;
+    header[3] = separate;
+    header[4] = sessions;
+    header[5] = 0;
+    model_digest(net, batches, &header[6]);
+    for (int i = 0; i < L; i++)
+        layer_shape(&net[i],
+                &header[6 + MODEL_DIGEST_WORDS + LAYER_SHAPE_WORDS*i]);
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL ||
+        fwrite(header.data(), sizeof(uint64), header.size(), file) !=
+            header.size() ||
+        fwrite(cache.data(), sizeof(uint64), cache.size(), file) !=
+            cache.size() ||
+        fclose(file) != 0)
+        cout << "Cannot write the cache " << path << endl, exit(1);
+}
+
+/*
+ * cache_take:
+ *    reads the first unused session of the cache file at path into session
+ *    (cache_session_words words) and marks it used.
+ *
+ * Returns:
+ *    Nothing. Exits if the cache is not about the same proofs, was built from
+ *    other weights, biases or input than net, or has no session left.
+ */
+void cache_take(const char* path, vector<layer>& net, int batches,
+        bool separate, uint64* session)
+{
+    int L = net.size();
+    uint64 words = cache_session_words(net, batches, separate);
+    vector<uint64> header(CACHE_HEADER_WORDS(L));
+
+    // the session counter is read and advanced under an exclusive lock, so
+    // that concurrent verifiers never take the same session; fclose drops it
+    FILE* file = fopen(path, "r+b");
+    if (file == NULL || flock(fileno(file), LOCK_EX) != 0 ||
+        fread(header.data(), sizeof(uint64), header.size(), file) !=
+            header.size())
+        cout << "Cannot read the cache " << path << endl, exit(1);
+
+    bool match = header[0] == CACHE_MAGIC && header[1] == L &&
+                 header[2] == batches && header[3] == separate;
+    uint64 shape[LAYER_SHAPE_WORDS];
+    for (int i = 0; match && i < L; i++)
+    {
+        layer_shape(&net[i], shape);
+        for (int k = 0; k < LAYER_SHAPE_WORDS; k++)
+            match = match && header[6 + MODEL_DIGEST_WORDS +
+                                   LAYER_SHAPE_WORDS*i + k] == shape[k];
+    }
+    if (!match)
+        cout << "The cache is not about this network" << endl, exit(1);
+
+    // a private-coin proof does not absorb the statement (see claim_init):
+    // its evaluations tie it to the model the cache was built from, which
+    // must be the verifier's
+    uint64 digest[MODEL_DIGEST_WORDS];
+    model_digest(net, batches, digest);
+    for (int k = 0; k < MODEL_DIGEST_WORDS; k++)
+        if (header[6 + k] != digest[k])
+            cout << "The cache was built from another model" << endl, exit(1);
+    if (header[5] >= header[4])
+        cout << "The cache has no session left" << endl, exit(1);
+
+    uint64 s = header[5]++;
+    if (fseek(file, (header.size() + s*words)*sizeof(uint64), SEEK_SET) != 0
+        || fread(session, sizeof(uint64), words, file) != words)
+        cout << "Cannot read the cache " << path << endl, exit(1);
+
+    // the session is used up before the proof starts
+    if (fseek(file, 0, SEEK_SET) != 0 ||
+        fwrite(header.data(), sizeof(uint64), header.size(), file) !=
+            header.size() ||
+        fclose(file) != 0)
+        cout << "Cannot update the cache " << path << endl, exit(1);
+}
@@ -0,0 +1,35 @@
+/*
+ * cache module header file
+ *
+ * This module contains the verifier's preprocessing cache. In private-coin
+ * mode the verifier samples the coins of future proofs offline; every point
+ * the weights and biases are evaluated at is a function of the coins, so
+ * their evaluations are computed ahead of time as well, and the online
+ * verifier only looks them up.
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <vector>
+
+#include "math.h"
+#include "model.h"
+
+#define CACHE_MAGIC 0x534e434143484532ULL  // "SNCACHE2"
+
+// number of words of the header of a cache of a network of L layers: magic,
+// L, batches, the separate activation flag, the number of sessions, the
+// first unused session, the digest of the network it was built from (see
+// model_digest) and the shape of every layer (see layer_shape)
+#define CACHE_HEADER_WORDS(L) (6 + MODEL_DIGEST_WORDS + LAYER_SHAPE_WORDS*(L))
+
+/* for information on these functions, read cache.cc */
+uint64 cache_coins(std::vector<layer>& net, int batches, bool separate);
+uint64 cache_session_words(std::vector<layer>& net, int batches,
+        bool separate);
+void cache_build(const char* path, std::vector<layer>& net, int batches,
+        bool separate, int sessions);
+void cache_take(const char* path, std::vector<layer>& net, int batches,
+        bool separate, uint64* session);
+
+#endif // CACHE_H
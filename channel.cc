@@ -0,0 +1,293 @@
+/*
+ * channel module
+ *
+ * This module contains the local Unix socket a prover streams its proof
+ * over. The verifier listens on a path and accepts a single prover; the
+ * connection is then wrapped in a stdio stream, so the records of the proof
+ * (see proof.h) are read and written exactly as they are from a file.
+ *
+ * A private-coin proof opens a second connection, its coin channel, right
+ * after the first. Before every challenge the prover sends the SHA-256
+ * digest of its transcript so far, i.e. of every message before the
+ * challenge, and the verifier answers with the next coin of its session
+ * (see cache.h). The records themselves are only written once a stage is
+ * done, so the verifier cannot read a round polynomial before the coin it
+ * depends on is due; it keeps the digests instead, and checks each against
+ * its own transcript as it reads the records: a prover that changed a
+ * message after seeing the coin that followed it would need a collision.
+ */
+#include <cstring>
+#include <iostream>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "channel.h"
+
+using namespace std;
+
+// how long a prover waits for the verifier to listen, in 10ms attempts
+#define CONNECT_ATTEMPTS 1000
+
+/*
+ * socket_address:
+ *    fills in the address of the socket at path.
+ */
+static void socket_address(const char* path, sockaddr_un* addr)
+{
+    if (strlen(path) >= sizeof(addr->sun_path))
+        cout << "Socket path too long: " << path << endl, exit(1);
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, path);
+}
+
+/*
+ * transfer:
+ *    sends (write) or receives len bytes of data on the socket fd.
+ *
+ * Returns:
+ *    bool: false if the connection fails or is closed first.
+ */
+static bool transfer(int fd, void* data, size_t len, bool write)
+{
+    char* p = (char*) data;
+    while (len > 0)
+    {
+        ssize_t n = write ? send(fd, p, len, MSG_NOSIGNAL) :
+                            recv(fd, p, len, 0);
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+/*
+ * channel_listen:
+ *    listens on the Unix socket at path for a prover.
+ *
+ * Params:
+ *    const char* path: the path of the socket; an existing file there is
+ *                      replaced
+ *
+ * Returns:
+ *    int: the listening socket. Exits if the socket cannot be set up.
+ */
+int channel_listen(const char* path)
+{
+    sockaddr_un addr;
+    socket_address(path, &addr);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if (fd < 0 || bind(fd, (sockaddr*) &addr, sizeof(addr)) < 0 ||
+        listen(fd, 2) < 0)
+        cout << "Cannot listen on " << path << endl, exit(1);
+    return fd;
+}
+
+/*
+ * channel_accept:
+ *    waits for a prover to connect to listener.
+ *
+ * Returns:
+ *    FILE*: the connection, open for reading. Exits if no prover can be
+ *           accepted.
+ */
+FILE* channel_accept(int listener)
+{
+    int conn = accept(listener, NULL, NULL);
+    if (conn < 0)
+        cout << "Cannot accept a prover" << endl, exit(1);
+    return fdopen(conn, "rb");
+}
+
+/*
+ * channel_accept_coins:
+ *    accepts the coin channel of a private-coin proof, the prover's second
+ *    connection to listener.
+ *
+ * Returns:
+ *    int: the coin channel. Exits if it cannot be accepted.
+ */
+int channel_accept_coins(int listener)
+{
+    int conn = accept(listener, NULL, NULL);
+    if (conn < 0)
+        cout << "Cannot accept the coin channel of the prover" << endl,
+             exit(1);
+    return conn;
+}
+
+/*
+ * channel_unlisten:
+ *    stops listening on the socket at path once the prover is connected.
+ */
+void channel_unlisten(int listener, const char* path)
+{
+    close(listener);
+    unlink(path);
+}
+
+/*
+ * connect_socket:
+ *    connects to a verifier listening on the Unix socket at path, waiting
+ *    for it to come up if needed.
+ *
+ * Returns:
+ *    int: the connection. Exits if no verifier shows up.
+ */
+static int connect_socket(const char* path)
+{
+    sockaddr_un addr;
+    socket_address(path, &addr);
+
+    for (int attempt = 0; attempt < CONNECT_ATTEMPTS; attempt++)
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            break;
+        if (connect(fd, (sockaddr*) &addr, sizeof(addr)) == 0)
+            return fd;
+        close(fd);
+        usleep(10000);
+    }
+    cout << "Cannot connect to a verifier on " << path << endl, exit(1);
+    return -1;
+}
+
+/*
+ * channel_connect:
+ *    connects to a verifier listening on the Unix socket at path, waiting
+ *    for it to come up if needed. A verifier that goes away makes the next
+ *    write fail rather than kill the prover.
+ *
+ * Params:
+ *    const char* path: the path of the socket
+ *
+ * Returns:
+ *    FILE*: the connection, open for writing. Exits if no verifier shows
+ *           up.
+ */
+FILE* channel_connect(const char* path)
+{
+    signal(SIGPIPE, SIG_IGN);
+    return fdopen(connect_socket(path), "wb");
+}
+
+/*
+ * channel_connect_coins:
+ *    opens the coin channel of a private-coin proof to the verifier at
+ *    path, after channel_connect.
+ *
+ * Returns:
+ *    int: the coin channel. Exits if no verifier shows up.
+ */
+int channel_connect_coins(const char* path)
+{
+    return connect_socket(path);
+}
+
+/*
+ * channel_coin:
+ *    sends the digest of the prover's transcript on the coin channel fd and
+ *    returns the coin the verifier answers with.
+ *
+ * Params:
+ *    int fd: the coin channel
+ *    const unsigned char* digest: the SHA256_DIGEST_BYTES of the digest
+ *
+ * Returns:
+ *    uint64: the coin, canonical. Exits if the verifier sends none.
+ */
+uint64 channel_coin(int fd, const unsigned char* digest)
+{
+    uint64 coin;
+    if (!transfer(fd, (void*) digest, SHA256_DIGEST_BYTES, true) ||
+        !transfer(fd, &coin, sizeof(coin), false) || coin >= PRIME)
+        cout << "Cannot get a coin from the verifier" << endl, exit(1);
+    return coin;
+}
+
+/*
+ * deal:
+ *    the thread of a coin dealer: answers every digest with the next coin
+ *    until all the coins are dealt or the prover goes away.
+ */
+static void deal(coin_dealer* cd)
+{
+    for (uint64 k = 0; k < cd->count; k++)
+    {
+        unsigned char digest[SHA256_DIGEST_BYTES];
+        if (!transfer(cd->fd, digest, sizeof(digest), false))
+            break;
+        {
+            lock_guard<mutex> guard(cd->lock);
+            memcpy(&cd->digests[k*SHA256_DIGEST_BYTES], digest,
+                    sizeof(digest));
+            cd->dealt = k + 1;
+        }
+        cd->cv.notify_all();
+        if (!transfer(cd->fd, (void*) &cd->coins[k], sizeof(uint64), true))
+            break;
+    }
+    lock_guard<mutex> guard(cd->lock);
+    cd->closed = true;
+    cd->cv.notify_all();
+}
+
+/*
+ * dealer_start:
+ *    starts dealing the count coins of a session on the coin channel fd.
+ *
+ * Params:
+ *    coin_dealer* cd: the dealer
+ *    int fd: the coin channel, closed by dealer_stop
+ *    const uint64* coins: the coins, in the order of the protocol
+ *    uint64 count: the number of coins
+ *
+ * Returns:
+ *    Nothing.
+ */
+void dealer_start(coin_dealer* cd, int fd, const uint64* coins, uint64 count)
+{
+    cd->fd = fd;
+    cd->coins = coins;
+    cd->count = count;
+    cd->digests.assign(count*SHA256_DIGEST_BYTES, 0);
+    cd->dealt = 0;
+    cd->closed = false;
+    cd->thread = thread(deal, cd);
+}
+
+/*
+ * dealer_digest:
+ *    waits for the digest the prover sent for coin k and copies it to
+ *    digest.
+ *
+ * Returns:
+ *    bool: false if the prover went away before asking for coin k.
+ */
+bool dealer_digest(coin_dealer* cd, uint64 k, unsigned char* digest)
+{
+    unique_lock<mutex> guard(cd->lock);
+    cd->cv.wait(guard, [&] { return cd->dealt > k || cd->closed; });
+    if (cd->dealt <= k)
+        return false;
+    memcpy(digest, &cd->digests[k*SHA256_DIGEST_BYTES], SHA256_DIGEST_BYTES);
+    return true;
+}
+
+/*
+ * dealer_stop:
+ *    stops the dealer and closes its coin channel.
+ */
+void dealer_stop(coin_dealer* cd)
+{
+    shutdown(cd->fd, SHUT_RDWR);
+    cd->thread.join();
+    close(cd->fd);
+}
@@ -0,0 +1,48 @@
+/*
+ * channel module header file
+ *
+ * This module contains the local Unix socket a prover streams its proof
+ * over to a verifier running in another process, and the coin channel a
+ * private-coin proof draws its challenges from.
+ */
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "math.h"
+#include "sha256.h"
+
+// the verifier's side of the coin channel of a private-coin proof: a thread
+// answers every digest the prover sends of its transcript with the next
+// coin, and keeps the digests for the verifier to check its own transcript
+// against (see transcript_challenge)
+struct coin_dealer {
+    int fd;
+    const uint64* coins;
+    uint64 count;
+    std::vector<unsigned char> digests;    // SHA256_DIGEST_BYTES per coin
+    uint64 dealt;                          // coins sent so far
+    bool closed;                           // the prover went away
+    std::mutex lock;
+    std::condition_variable cv;
+    std::thread thread;
+};
+
+/* for information on these functions, read channel.cc */
+int channel_listen(const char* path);
+FILE* channel_accept(int listener);
+int channel_accept_coins(int listener);
+void channel_unlisten(int listener, const char* path);
+FILE* channel_connect(const char* path);
+int channel_connect_coins(const char* path);
+uint64 channel_coin(int fd, const unsigned char* digest);
+void dealer_start(coin_dealer* cd, int fd, const uint64* coins, uint64 count);
+bool dealer_digest(coin_dealer* cd, uint64 k, unsigned char* digest);
+void dealer_stop(coin_dealer* cd);
+
+#endif // CHANNEL_H
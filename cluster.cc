@@ -0,0 +1,673 @@
+/*
+ * cluster module
+ *
+ * This module contains the distributed prover. The samples of a batch, the
+ * rows of the activations of every layer, are split across W worker
+ * processes, worker w owning the w-th of W contiguous slices of every batch
+ * (W a power of two). Samples are independent until a sum-check binds them,
+ * so a worker runs the forward pass on its slice alone and holds the only
+ * up-to-date copy of its part of the activations. The coordinator, the
+ * process writing the proof, drives every sum-check: it adds up the partial
+ * sums the workers send for a round, draws the challenge and sends it back.
+ *
+ * The slice of a worker is the value of the log W high-order variables of
+ * the rows, which are the high-order variables of the tables of the bias and
+ * activation stages too:
+ *
+ *  - the square activation binds variables low-order first, so the workers
+ *    run all but its last log W rounds on their slices, then send their
+ *    folded tables, of a single entry, on which the coordinator runs the
+ *    last rounds;
+ *  - the bias binds variables high-order first: its first log W rounds are
+ *    the sum-check of eq(q, w) A(w) over the worker index w, A(w) the sum of
+ *    eq(q, x) (Y + b)(x) over the slice of worker w, and the sums of its
+ *    later rounds are those of the workers on their slices, weighted by the
+ *    eq table of the first challenges;
+ *  - the matrix multiplication pre-binds the rows of its input: each worker
+ *    binds those of its slice, and the coordinator adds up the tables.
+ *
+ * The proof is the same as that of a single process. The workers are forked
+ * from the coordinator once the network is built, run their own thread
+ * pool, and are sent requests (a command and a layer, then its arguments)
+ * over a Unix socket pair each. Convolutional layers are not distributed.
+ */
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cluster.h"
+#include "gemm.h"
+#include "kernels.h"
+#include "mle.h"
+#include "stats.h"
+#include "stream.h"
+#include "threadpool.h"
+
+using namespace std;
+
+// the commands of the requests of the coordinator to a worker
+#define CLUSTER_FORWARD 1
+#define CLUSTER_PREBIND 2
+#define CLUSTER_BIAS 3
+#define CLUSTER_SQR 4
+#define CLUSTER_STOP 5
+
+static vector<layer>* cluster_net = NULL;
+static int cluster_batches = 0;
+static int cluster_workers = 0;
+static int log_workers = 0;
+// the socket of every worker, on the coordinator's side
+static vector<int> sockets;
+static vector<pid_t> pids;
+
+/*
+ * send_words, recv_words:
+ *    write or read n words on the socket fd, exiting if the process on the
+ *    other side is gone.
+ */
+static void send_words(int fd, const uint64* words, uint64 n)
+{
+    const char* buf = (const char*) words;
+    size_t left = n*sizeof(uint64);
+    while (left > 0)
+    {
+        ssize_t k = write(fd, buf, left);
+        if (k <= 0)
+            cout << "Lost a process of the cluster" << endl, exit(1);
+        buf += k;
+        left -= k;
+    }
+}
+
+static void recv_words(int fd, uint64* words, uint64 n)
+{
+    char* buf = (char*) words;
+    size_t left = n*sizeof(uint64);
+    while (left > 0)
+    {
+        ssize_t k = read(fd, buf, left);
+        if (k <= 0)
+            cout << "Lost a process of the cluster" << endl, exit(1);
+        buf += k;
+        left -= k;
+    }
+}
+
+/*
+ * broadcast:
+ *    sends the request of command cmd about layer l to every worker,
+ *    followed by its arguments: the n words of point, the coefficients rho
+ *    of the batches and, if rho_sum is not NULL, their sum.
+ */
+static void broadcast(uint64 cmd, layer* l, const uint64* point, uint64 n,
+        const uint64* rho, const uint64* rho_sum)
+{
+    uint64 head[2] = {cmd, l ? (uint64)(l - &(*cluster_net)[0]) : 0};
+    for (int w = 0; w < cluster_workers; w++)
+    {
+        send_words(sockets[w], head, 2);
+        send_words(sockets[w], point, n);
+        if (rho)
+            send_words(sockets[w], rho, cluster_batches);
+        if (rho_sum)
+            send_words(sockets[w], rho_sum, 1);
+    }
+}
+
+// eq(point, w) over the log W variables of the worker index
+static uint64 worker_eq(const uint64* point, int w)
+{
+    uint64 eq = 1;
+    for (int b = 0; b < log_workers; b++)
+        eq = myModMult(eq, ((w >> b) & 1) ? point[b] :
+                       myMod(1 + PRIME - point[b]));
+    return eq;
+}
+
+/*
+ * worker_footprint:
+ *    returns the arena footprint of a worker on the network net.
+ */
+static size_t worker_footprint(vector<layer>& net, int batches)
+{
+    int nthreads = threadpool_size();
+    size_t stage = 0;
+    for (size_t i = 0; i < net.size(); i++)
+    {
+        int e = net[i].e, d = net[i].d, f = net[i].f;
+        uint64 rows = myPow(2, e - log_workers);
+        uint64 p = myPow(2, f);
+        uint64 nl = rows*p;
+        stage = max(stage, gemm_scratch_bytes(nthreads) +
+                arena_words_bytes(batches*nl));
+        stage = max(stage, 2*arena_words_bytes(myPow(2, d)) +
+                arena_words_bytes(f + e + batches) +
+                bind_rows_bytes(e - log_workers));
+        stage = max(stage, 2*arena_words_bytes(nl) +
+                arena_words_bytes(e + f + batches + 1) + round_sums_bytes());
+        stage = max(stage, arena_words_bytes((batches + 1)*nl) +
+                arena_words_bytes((batches + 1)*(nl/2 + 1)) +
+                arena_words_bytes(4*nthreads) +
+                arena_words_bytes(e + f + batches));
+    }
+    return stage;
+}
+
+/*
+ * worker_forward:
+ *    runs the network on the slice of worker w, and sends the coordinator
+ *    its slice of the output, batch after batch.
+ */
+static void worker_forward(int fd, int w, arena* mem)
+{
+    vector<layer>& net = *cluster_net;
+    int batches = cluster_batches;
+    int L = net.size();
+    for (int i = 0; i < L; i++)
+    {
+        layer* l = &net[i];
+        uint64 n = myPow(2, l->d);
+        uint64 m = myPow(2, l->e);
+        uint64 p = myPow(2, l->f);
+        uint64 rows = m >> log_workers;
+        uint64 row0 = w*rows;
+        arena_reset(mem);
+        for (int b = 0; b < batches; b++)
+            gemm_mod(elem_at(l->X, l->Xtype, b*m*n + row0*n), l->Xtype,
+                    l->W, l->Wtype, l->Y + b*m*p + row0*p, rows, n, p,
+                    l->n_true, l->p_true, mem);
+
+        uint64* next = (i == L-1) ? arena_words(mem, batches*rows*p) :
+                       (uint64*) net[i+1].X;
+        for (int b = 0; b < batches; b++)
+        {
+            uint64 base = b*m*p + row0*p;
+            for (uint64 k = 0; k < rows*p; k++)
+            {
+                uint64 s = myMod(l->Y[base + k] + l->b[k & (p-1)]);
+                if (i == L-1)
+                    next[b*rows*p + k] = myModCanon(s);
+                else
+                    next[base + k] = myModMult(s, s);
+            }
+        }
+        if (i == L-1)
+            send_words(fd, next, batches*rows*p);
+    }
+}
+
+/*
+ * worker_prebind:
+ *    binds the row variables of the input of layer l on the slice of worker
+ *    w (see prebind_mm), and sends the coordinator its part of the table.
+ */
+static void worker_prebind(int fd, int w, layer* l, arena* mem)
+{
+    int e = l->e, f = l->f;
+    int batches = cluster_batches;
+    uint64 n = myPow(2, l->d);
+    uint64 m = myPow(2, e);
+    uint64 rows = m >> log_workers;
+    uint64* args = arena_words(mem, f + e + batches);
+    recv_words(fd, args, f + e + batches);
+    uint64* z = args;
+    uint64* rho = args + f + e;
+
+    uint64* A = arena_zeros(mem, n);
+    uint64* A_b = arena_words(mem, n);
+    uint64 eq = worker_eq(z + f + e - log_workers, w);
+    for (int b = 0; b < batches; b++)
+    {
+        bind_rows(elem_at(l->X, l->Xtype, b*m*n + w*rows*n), l->Xtype,
+                e - log_workers, rows, n, l->n_true, z + f, A_b, mem);
+        scale_add_kernel(A, A_b, batches > 1 ? myModMult(rho[b], eq) : eq,
+                l->n_true);
+    }
+    send_words(fd, A, n);
+}
+
+/*
+ * worker_bias:
+ *    runs the rounds of the bias of layer l on the slice of worker w (see
+ *    cluster_bias_rounds): sends A(w), then the sums of every round over
+ *    the local variables, folding its tables with the challenge it gets
+ *    back, and the folded S last.
+ */
+static void worker_bias(int fd, int w, layer* l, arena* mem)
+{
+    int d = l->e + l->f;
+    int dl = d - log_workers;
+    int batches = cluster_batches;
+    uint64 n = myPow(2, d);
+    uint64 p = myPow(2, l->f);
+    uint64 size = n >> log_workers;
+    uint64 off = w*size;
+    uint64* args = arena_words(mem, d + batches + 1);
+    recv_words(fd, args, d + batches + 1);
+    uint64* q = args;
+    uint64* rho = args + d;
+    uint64 rho_sum = args[d + batches];
+
+    uint64* I = arena_words(mem, size);
+    uint64* S = arena_words(mem, size);
+    eq_table(q, dl, I);
+    parallel_for(size, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int) {
+        for (uint64 j = b; j < e; j++)
+        {
+            if (batches == 1)
+            {
+                S[j] = myMod(l->Y[off + j] + l->b[j & (p-1)]);
+                continue;
+            }
+            Fp61Acc s;
+            for (int t = 0; t < batches; t++)
+                s.addmul(l->Y[t*n + off + j], rho[t]);
+            s.addmul(l->b[j & (p-1)], rho_sum);
+            S[j] = s.value().v;
+        }
+    });
+
+    // A(w) is the sum of the first round's sums at 0 and 1
+    uint64 sums[3];
+    uint64 a = myModMult(I[0], S[0]);
+    if (dl > 0)
+    {
+        round_sums_parallel(I, I + size/2, S, S + size/2, size/2, sums,
+                mem);
+        a = myMod(sums[0] + sums[1]);
+    }
+    send_words(fd, &a, 1);
+
+    for (int i = 0; i < dl; i++, size >>= 1)
+    {
+        uint64 h = size/2;
+        if (i > 0)
+            round_sums_parallel(I, I + h, S, S + h, h, sums, mem);
+        send_words(fd, sums, 3);
+        uint64 r;
+        recv_words(fd, &r, 1);
+        fold_parallel(I, I, I + h, h, r);
+        fold_parallel(S, S, S + h, h, r);
+    }
+    send_words(fd, S, 1);
+}
+
+/*
+ * worker_sqr:
+ *    runs the rounds of the square activation of layer l on the slice of
+ *    worker w (see cluster_sqr_rounds): sends the sums of every round over
+ *    the local variables, folding its tables with the challenge it gets
+ *    back, and the folded tables last.
+ */
+static void worker_sqr(int fd, int w, layer* l, arena* mem)
+{
+    int d = l->e + l->f;
+    int dl = d - log_workers;
+    int batches = cluster_batches;
+    uint64 n = myPow(2, d);
+    uint64 p = myPow(2, l->f);
+    uint64 size = n >> log_workers;
+    uint64 off = w*size;
+    uint64* args = arena_words(mem, d + batches);
+    recv_words(fd, args, d + batches);
+    uint64* q = args;
+    uint64* rho = args + d;
+
+    // eq(q, x) on the slice, then the slice of every batch
+    uint64* T = arena_words(mem, (batches + 1)*size);
+    uint64* U = arena_words(mem, (batches + 1)*(size/2 + 1));
+    uint64* partial = arena_words(mem, 4*threadpool_size());
+    eq_table(q, dl, T);
+    uint64 eq = worker_eq(q + dl, w);
+    parallel_for(size, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int) {
+        for (uint64 j = b; j < e; j++)
+        {
+            T[j] = myModMult(T[j], eq);
+            for (int t = 0; t < batches; t++)
+                T[(t+1)*size + j] = myMod(l->Y[t*n + off + j] +
+                        l->b[j & (p-1)]);
+        }
+    });
+
+    for (int i = 0; i < dl; i++, size >>= 1)
+    {
+        uint64 sums[4];
+        sqr_table_sums(T, size, batches, rho, partial, sums);
+        send_words(fd, sums, 4);
+        uint64 r;
+        recv_words(fd, &r, 1);
+        sqr_table_fold(T, size, batches, r, U);
+        uint64* next = U;
+        U = T;
+        T = next;
+    }
+    send_words(fd, T, batches + 1);
+}
+
+/*
+ * worker_main:
+ *    serves the requests of the coordinator on fd until it is stopped.
+ */
+static void worker_main(int fd, int w, int threads)
+{
+    threadpool_init(threads);
+    arena mem;
+    arena_init(&mem, worker_footprint(*cluster_net, cluster_batches));
+    for (;;)
+    {
+        uint64 head[2];
+        recv_words(fd, head, 2);
+        layer* l = &(*cluster_net)[head[1]];
+        arena_reset(&mem);
+        if (head[0] == CLUSTER_FORWARD)
+            worker_forward(fd, w, &mem);
+        else if (head[0] == CLUSTER_PREBIND)
+            worker_prebind(fd, w, l, &mem);
+        else if (head[0] == CLUSTER_BIAS)
+            worker_bias(fd, w, l, &mem);
+        else if (head[0] == CLUSTER_SQR)
+            worker_sqr(fd, w, l, &mem);
+        else
+            break;
+    }
+    arena_destroy(&mem);
+    threadpool_shutdown();
+}
+
+/*
+ * cluster_start:
+ *    forks workers worker processes, each with a pool of threads threads,
+ *    that will run the forward pass and the sum-checks of net on their
+ *    slices of the batches. Must be called before the thread pool of the
+ *    coordinator is started, as threads do not survive a fork.
+ *
+ * Params:
+ *    vector<layer>& net: the network, without its activations yet
+ *    int batches: the number of batches
+ *    int workers: the number of workers, a power of two no larger than the
+ *                 number of samples of a batch
+ *    int threads: the number of threads of every worker
+ *
+ * Returns:
+ *    Nothing. Exits if the network cannot be distributed this way.
+ */
+void cluster_start(vector<layer>& net, int batches, int workers, int threads)
+{
+    int lw = 0;
+    while ((1 << lw) < workers)
+        lw++;
+    if (workers < 1 || (1 << lw) != workers || lw > net[0].e)
+        cout << "The number of workers must be a power of two no larger than"
+             << " the batch." << endl, exit(1);
+    for (size_t i = 0; i < net.size(); i++)
+        if (net[i].k)
+            cout << "Convolutional layers cannot be proven by a cluster."
+                 << endl, exit(1);
+
+    cluster_net = &net;
+    cluster_batches = batches;
+    cluster_workers = workers;
+    log_workers = lw;
+    // a write to a worker that is gone fails instead of killing the
+    // coordinator, and nothing buffered is written twice by a child
+    signal(SIGPIPE, SIG_IGN);
+    cout << flush;
+    fflush(NULL);
+    for (int w = 0; w < workers; w++)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            cout << "Cannot create the sockets of the cluster" << endl,
+                 exit(1);
+        pid_t pid = fork();
+        if (pid < 0)
+            cout << "Cannot fork the workers of the cluster" << endl, exit(1);
+        if (pid == 0)
+        {
+            close(fds[0]);
+            for (size_t k = 0; k < sockets.size(); k++)
+                close(sockets[k]);
+            worker_main(fds[1], w, threads);
+            _exit(0);
+        }
+        close(fds[1]);
+        sockets.push_back(fds[0]);
+        pids.push_back(pid);
+    }
+}
+
+/*
+ * cluster_stop:
+ *    stops the workers and waits for them to exit.
+ */
+void cluster_stop()
+{
+    broadcast(CLUSTER_STOP, NULL, NULL, 0, NULL, NULL);
+    for (int w = 0; w < cluster_workers; w++)
+    {
+        close(sockets[w]);
+        waitpid(pids[w], NULL, 0);
+    }
+    sockets.clear();
+    pids.clear();
+    cluster_workers = 0;
+}
+
+/*
+ * cluster_size:
+ *    returns the number of workers, 0 if the prover runs in one process.
+ */
+int cluster_size()
+{
+    return cluster_workers;
+}
+
+/*
+ * cluster_footprint:
+ *    returns the arena footprint of the coordinator's part of the bias and
+ *    activation stages of a layer with e row and f column variables,
+ *    including their round polynomials, 0 without a cluster. That of the
+ *    pre-binding is within that of prove_mm.
+ */
+size_t cluster_footprint(int e, int f, int batches)
+{
+    if (!cluster_workers)
+        return 0;
+    uint64 W = cluster_workers;
+    int d = e + f;
+    size_t stage = arena_words_bytes(4*d + batches) + arena_words_bytes(d);
+    return stage + max(3*arena_words_bytes(W) + mle_scratch_bytes(0, f, 1),
+            arena_words_bytes((batches + 1)*W) +
+            arena_words_bytes((batches + 1)*(W/2 + 1)) +
+            arena_words_bytes(4*threadpool_size()) +
+            arena_words_bytes(batches + 1));
+}
+
+/*
+ * cluster_forward:
+ *    forward, run by the workers on their slices; out receives the output
+ *    of the network.
+ *
+ * Returns:
+ *    runtime: the (unverifiable) time of the whole inference.
+ */
+runtime cluster_forward(vector<layer>& net, int batches, uint64* out)
+{
+    layer* last = &net[net.size() - 1];
+    uint64 m = myPow(2, last->e);
+    uint64 p = myPow(2, last->f);
+    uint64 rows = m >> log_workers;
+    stat_scope top;
+    stats_layer(0);
+    stats_begin(&top, "forward", NULL);
+    broadcast(CLUSTER_FORWARD, NULL, NULL, 0, NULL, NULL);
+    for (int w = 0; w < cluster_workers; w++)
+        for (int b = 0; b < batches; b++)
+            recv_words(sockets[w], out + b*m*p + w*rows*p, rows*p);
+    double ut = stats_end(&top);
+    cout << "unverifiable time for the network on " << cluster_workers
+         << " workers = " << ut << endl;
+
+    runtime forward_runtime;
+    return set_time(forward_runtime, ut, 0, 0);
+}
+
+/*
+ * cluster_prebind:
+ *    prebind_mm for layer l, the workers binding the rows of the input: A
+ *    receives the sum of their tables, and B the weights bound here.
+ */
+void cluster_prebind(layer* l, claim* c, uint64* z, uint64* A, uint64* B,
+        arena* mem)
+{
+    int e = l->e, d = l->d, f = l->f;
+    uint64 n = myPow(2, d);
+    broadcast(CLUSTER_PREBIND, l, z, f + e, c->rho, NULL);
+
+    uint64* A_w = arena_words(mem, n);
+    for (uint64 k = 0; k < n; k++)
+        A[k] = 0;
+    for (int w = 0; w < cluster_workers; w++)
+    {
+        recv_words(sockets[w], A_w, n);
+        for (uint64 k = 0; k < n; k++)
+            A[k] = myMod(A[k] + A_w[k]);
+    }
+    bind_rows(l->W, l->Wtype, f, l->p_true, n, l->n_true, z, B, mem);
+}
+
+/*
+ * cluster_bias_rounds:
+ *    the rounds of prove_bias on layer l and its claim c, the sums of the
+ *    last d - log W rounds being added up from the workers (see the top of
+ *    this file). See check_bias_layer for r and F.
+ *
+ * Returns:
+ *    uint64: S~(r), S the combined output of the bias.
+ */
+uint64 cluster_bias_rounds(layer* l, claim* c, uint64* r, uint64 rho_sum,
+        uint64* F, transcript* tr, arena* mem)
+{
+    int d = l->e + l->f;
+    int dl = d - log_workers;
+    uint64 W = cluster_workers;
+    broadcast(CLUSTER_BIAS, l, c->point, d, c->rho, &rho_sum);
+
+    // the first rounds, on eq(q, w) and A(w)
+    uint64* A = arena_words(mem, W);
+    uint64* I = arena_words(mem, W);
+    for (uint64 w = 0; w < W; w++)
+        recv_words(sockets[w], A + w, 1);
+    eq_table(c->point + dl, log_workers, I);
+    uint64 sums[3];
+    for (int i = 0; i < log_workers; i++)
+    {
+        uint64 h = W >> (i + 1);
+        uint64* Fi = F + 3*i;
+        round_sums_kernel(I, I + h, A, A + h, h, sums);
+        for (int k = 0; k < 3; k++)
+            Fi[k] = Fp61(sums[k]).canonical();
+        transcript_absorb(tr, Fi, 3);
+        r[d-1-i] = transcript_challenge(tr);
+        fold_kernel(I, I, I + h, h, r[d-1-i]);
+        fold_kernel(A, A, A + h, h, r[d-1-i]);
+    }
+
+    // the later rounds: eq(q, x) folded is eq(q, r) on the worker variables
+    // times eq(q, x) on the local ones, and S folded is the sum of the
+    // folded slices weighted by eq(r, w)
+    uint64 scale = I[0];
+    uint64* ew = arena_words(mem, W);
+    eq_table(r + dl, log_workers, ew);
+    for (int i = log_workers; i < d; i++)
+    {
+        Fp61Acc acc[3];
+        for (uint64 w = 0; w < W; w++)
+        {
+            recv_words(sockets[w], sums, 3);
+            for (int k = 0; k < 3; k++)
+                acc[k].addmul(ew[w], sums[k]);
+        }
+        uint64* Fi = F + 3*i;
+        for (int k = 0; k < 3; k++)
+            Fi[k] = Fp61(myModMult(scale, acc[k].value().v)).canonical();
+        transcript_absorb(tr, Fi, 3);
+        r[d-1-i] = transcript_challenge(tr);
+        for (uint64 w = 0; w < W; w++)
+            send_words(sockets[w], r + d-1-i, 1);
+    }
+
+    Fp61Acc S;
+    for (uint64 w = 0; w < W; w++)
+    {
+        uint64 s;
+        recv_words(sockets[w], &s, 1);
+        S.addmul(ew[w], s);
+    }
+    return S.value().canonical();
+}
+
+/*
+ * cluster_sqr_rounds:
+ *    the rounds of the square activation of layer l on its claim c, the
+ *    sums of the first d - log W rounds being added up from the workers
+ *    (see the top of this file). See sqr_rounds for r, F and finals.
+ */
+void cluster_sqr_rounds(layer* l, claim* c, uint64* r, uint64* F,
+        uint64* finals, transcript* tr, arena* mem)
+{
+    int d = l->e + l->f;
+    int dl = d - log_workers;
+    int batches = c->batches;
+    uint64 W = cluster_workers;
+    broadcast(CLUSTER_SQR, l, c->point, d, c->rho, NULL);
+
+    uint64 sums[4];
+    for (int i = 0; i < dl; i++)
+    {
+        Fp61Acc acc[4];
+        for (uint64 w = 0; w < W; w++)
+        {
+            recv_words(sockets[w], sums, 4);
+            for (int m = 0; m < 4; m++)
+                acc[m].add(sums[m]);
+        }
+        uint64* Fi = F + 4*i;
+        for (int m = 0; m < 4; m++)
+            Fi[m] = acc[m].value().canonical();
+        transcript_absorb(tr, Fi, 4);
+        r[i] = transcript_challenge(tr);
+        for (uint64 w = 0; w < W; w++)
+            send_words(sockets[w], r + i, 1);
+    }
+
+    // the last rounds, on the folded tables of the workers, laid out as in
+    // sqr_table_sums
+    uint64* T = arena_words(mem, (batches + 1)*W);
+    uint64* U = arena_words(mem, (batches + 1)*(W/2 + 1));
+    uint64* partial = arena_words(mem, 4*threadpool_size());
+    uint64* folded = arena_words(mem, batches + 1);
+    for (uint64 w = 0; w < W; w++)
+    {
+        recv_words(sockets[w], folded, batches + 1);
+        for (int t = 0; t <= batches; t++)
+            T[t*W + w] = folded[t];
+    }
+    uint64 size = W;
+    for (int i = dl; i < d; i++, size >>= 1)
+    {
+        uint64* Fi = F + 4*i;
+        sqr_table_sums(T, size, batches, c->rho, partial, Fi);
+        transcript_absorb(tr, Fi, 4);
+        r[i] = transcript_challenge(tr);
+        sqr_table_fold(T, size, batches, r[i], U);
+        uint64* next = U;
+        U = T;
+        T = next;
+    }
+    for (int t = 0; t < batches; t++)
+        finals[t] = myModCanon(T[t+1]);
+}
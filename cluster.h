@@ -0,0 +1,36 @@
+/*
+ * cluster module header file
+ *
+ * This module contains the distributed prover: worker processes that each
+ * own a slice of the samples of every batch, run the forward pass on it and
+ * return the partial sums of the sum-checks over it to the coordinator, the
+ * process writing the proof.
+ */
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "arena.h"
+#include "math.h"
+#include "model.h"
+#include "proof.h"
+#include "transcript.h"
+#include "util.h"
+
+/* for information on these functions, read cluster.cc */
+void cluster_start(std::vector<layer>& net, int batches, int workers,
+        int threads);
+void cluster_stop();
+int cluster_size();
+size_t cluster_footprint(int e, int f, int batches);
+runtime cluster_forward(std::vector<layer>& net, int batches, uint64* out);
+void cluster_prebind(layer* l, claim* c, uint64* z, uint64* A, uint64* B,
+        arena* mem);
+uint64 cluster_bias_rounds(layer* l, claim* c, uint64* r, uint64 rho_sum,
+        uint64* F, transcript* tr, arena* mem);
+void cluster_sqr_rounds(layer* l, claim* c, uint64* r, uint64* F,
+        uint64* finals, transcript* tr, arena* mem);
+
+#endif // CLUSTER_H
@@ -0,0 +1,375 @@
+/*
+ * conv module
+ *
+ * This module contains the convolutional layer. A layer of kernel size k
+ * (see struct layer) maps C input channels of H x W to O output channels of
+ * H x W, stride 1, the input being zero past its border:
+ *
+ *   Y[s, o, y, x] = sum_{c, i, j < k} W[o, c, i, j] X[s, c, y+i-k/2, x+j-k/2]
+ *
+ * Every sample is a row of X and Y, its channels and pixels the columns, in
+ * this order; the kernel is a matrix of O rows over the index (c, i, j), i
+ * and j padded to K = 2^kv. Written Y = P W^T over the patches P of X, the
+ * layer is proven like a fully connected one over the small kernel index
+ * (see prove_conv), and the claim about P~ that leaves is reduced to one
+ * about X~ by a second sum-check over the entries of X (a product with the
+ * table G of conv_input_table). Neither the prover nor the verifier ever
+ * builds P: the prover binds X once, and the verifier evaluates G~ in
+ * O(H k + W k) from the same shift tables.
+ */
+#include "conv.h"
+#include "mle.h"
+#include "stats.h"
+#include "threadpool.h"
+
+/*
+ * conv_kernel_vars:
+ *    returns kv, the number of variables of a row (or a column) of a kernel
+ *    of size k.
+ */
+int conv_kernel_vars(int k)
+{
+    int kv = 0;
+    while ((1 << kv) < k)
+        kv++;
+    return kv;
+}
+
+/*
+ * conv_weight_vars:
+ *    returns the number of column variables of the weights of a
+ *    convolutional layer of d input variables, kernel size k and log
+ *    spatial size (h, w): the variables of the index (c, i, j).
+ */
+int conv_weight_vars(int d, int k, int h, int w)
+{
+    return d - h - w + 2*conv_kernel_vars(k);
+}
+
+/*
+ * conv_scratch_bytes:
+ *    returns the arena footprint of conv_forward on maps of log size (h, w)
+ *    on nthreads threads.
+ */
+size_t conv_scratch_bytes(int h, int w, int nthreads)
+{
+    uint64 hw = myPow(2, h + w);
+    return arena_bytes(nthreads*hw*sizeof(Fp61Acc)) +
+           arena_words_bytes(nthreads*hw);
+}
+
+/*
+ * conv_tables_bytes:
+ *    returns the arena footprint of conv_bind_patches and conv_input_table
+ *    on a layer of log sizes (e, d), kernel size k and log map size (h, w).
+ */
+size_t conv_tables_bytes(int e, int d, int k, int h, int w)
+{
+    uint64 K = myPow(2, conv_kernel_vars(k));
+    uint64 H = myPow(2, h);
+    uint64 Wd = myPow(2, w);
+    uint64 C = myPow(2, d - h - w);
+    size_t bind = arena_words_bytes(Wd) + arena_words_bytes(H) +
+                  arena_words_bytes(C*H*K);
+    size_t input = arena_words_bytes(myPow(2, e)) + arena_words_bytes(C) +
+                   arena_words_bytes(H) + arena_words_bytes(Wd) +
+                   arena_words_bytes(K) + arena_words_bytes(H > Wd ? H : Wd);
+    return bind > input ? bind : input;
+}
+
+/*
+ * conv_forward:
+ *    computes the output Y of the convolutional layer l on one batch X, one
+ *    task per (sample, output channel). Every input channel of the sample is
+ *    lifted to field elements once per task, and every weight is applied to
+ *    the part of the channel it reaches; the channels past the true number
+ *    of outputs are zeroed.
+ *
+ * Params:
+ *    const void* X: the input, m x n, row-major
+ *    int Xtype: the storage type of X
+ *    const void* W: the kernel, O rows over the index (c, i, j)
+ *    int Wtype: the storage type of W
+ *    uint64* Y: receives the output, m x p, canonical
+ *    const layer* l: the layer
+ *    arena* scratch: the arena the accumulators are taken from, see
+ *                    conv_scratch_bytes
+ *
+ * Returns:
+ *    Nothing.
+ */
+void conv_forward(const void* X, int Xtype, const void* W, int Wtype,
+        uint64* Y, const layer* l, arena* scratch)
+{
+    int kv = conv_kernel_vars(l->k);
+    int64_t H = myPow(2, l->h);
+    int64_t Wd = myPow(2, l->w);
+    uint64 hw = H*Wd;
+    uint64 m = myPow(2, l->e);
+    uint64 n = myPow(2, l->d);
+    uint64 p = myPow(2, l->f);
+    uint64 O = p/hw;
+    uint64 C_true = l->n_true/hw;
+    uint64 O_true = l->p_true/hw;
+    uint64 nw = myPow(2, conv_weight_vars(l->d, l->k, l->h, l->w));
+    uint64 K = myPow(2, kv);
+    int64_t k = l->k;
+    int64_t pad = k/2;
+    stats_count(m*l->n_true*O_true*k*k, m*l->n_true*elem_bytes(Xtype) +
+            O_true*nw*elem_bytes(Wtype) + m*p*sizeof(uint64));
+
+    int nthreads = threadpool_size();
+    size_t mark = arena_mark(scratch);
+    Fp61Acc* acc = (Fp61Acc*) arena_alloc(scratch,
+            nthreads*hw*sizeof(Fp61Acc));
+    uint64* plane = arena_words(scratch, nthreads*hw);
+
+    parallel_for(m*O, 1, [&](uint64 b, uint64 e, int id) {
+        Fp61Acc* a = acc + id*hw;
+        uint64* in = plane + id*hw;
+        for (uint64 task = b; task < e; task++)
+        {
+            uint64 s = task / O;
+            uint64 o = task % O;
+            uint64* out = Y + s*p + o*hw;
+            if (o >= O_true)
+            {
+                for (uint64 t = 0; t < hw; t++)
+                    out[t] = 0;
+                continue;
+            }
+
+            for (uint64 t = 0; t < hw; t++)
+                a[t] = Fp61Acc();
+            for (uint64 c = 0; c < C_true; c++)
+            {
+                for (uint64 t = 0; t < hw; t++)
+                    in[t] = elem_get(X, Xtype, s*n + c*hw + t);
+                // output (y, x) reads input (y+i-k/2, x+j-k/2), when inside
+                for (int64_t i = 0; i < k; i++)
+                {
+                    int64_t y0 = (pad - i > 0) ? pad - i : 0;
+                    int64_t y1 = (pad - i < 0) ? H + pad - i : H;
+                    for (int64_t j = 0; j < k; j++)
+                    {
+                        uint64 wv = elem_get(W, Wtype,
+                                o*nw + (c*K + i)*K + j);
+                        if (wv == 0)
+                            continue;
+                        int64_t x0 = (pad - j > 0) ? pad - j : 0;
+                        int64_t x1 = (pad - j < 0) ? Wd + pad - j : Wd;
+                        for (int64_t y = y0; y < y1; y++)
+                        {
+                            int64_t src = (y+i-pad)*Wd + j-pad;
+                            Fp61Acc* dst = a + y*Wd;
+                            for (int64_t x = x0; x < x1; x++)
+                                dst[x].addmul(in[src + x], wv);
+                        }
+                    }
+                }
+            }
+            for (uint64 t = 0; t < hw; t++)
+                out[t] = a[t].value().canonical();
+        }
+    });
+
+    arena_release(scratch, mark);
+}
+
+/*
+ * conv_bind_patches:
+ *    binds the sample, row and column variables of the patches P of the
+ *    input of layer l to the point z of a claim about its output, leaving
+ *    the table A over the kernel index (c, i, j):
+ *
+ *      A[c, i, j] = sum_{y, x} eq(z_y, y) eq(z_x, x) Xs[c, y+i-k/2, x+j-k/2]
+ *
+ *    where Xs is the input with its sample variables already bound. The
+ *    columns and the rows of the kernel are bound one after the other.
+ *
+ * Params:
+ *    const uint64* Xs: the bound input, n entries (c, u, v)
+ *    const layer* l: the layer
+ *    uint64* z: the point of the claim, w column then h row coordinates
+ *               first
+ *    uint64* A: receives the table, 2^conv_weight_vars entries
+ *    arena* scratch: the arena the working tables are taken from
+ *
+ * Returns:
+ *    Nothing.
+ */
+void conv_bind_patches(const uint64* Xs, const layer* l, uint64* z,
+        uint64* A, arena* scratch)
+{
+    int kv = conv_kernel_vars(l->k);
+    uint64 H = myPow(2, l->h);
+    uint64 Wd = myPow(2, l->w);
+    uint64 hw = H*Wd;
+    uint64 C_true = l->n_true/hw;
+    uint64 nw = myPow(2, conv_weight_vars(l->d, l->k, l->h, l->w));
+    uint64 K = myPow(2, kv);
+    int64_t k = l->k;
+    int64_t pad = k/2;
+
+    size_t mark = arena_mark(scratch);
+    uint64* Ex = arena_words(scratch, Wd);
+    uint64* Ey = arena_words(scratch, H);
+    eq_table(z, l->w, Ex);
+    eq_table(z + l->w, l->h, Ey);
+    for (uint64 t = 0; t < nw; t++)
+        A[t] = 0;
+    stats_count(C_true*k*H*(Wd + k), C_true*hw*sizeof(uint64) +
+            nw*sizeof(uint64));
+
+    // T[c, u, j] = sum_x eq(z_x, x) Xs[c, u, x+j-k/2], then the rows
+    uint64* T = arena_words(scratch, C_true*H*K);
+    parallel_for(C_true, 1, [&](uint64 b, uint64 e, int) {
+        for (uint64 c = b; c < e; c++)
+        {
+            for (uint64 u = 0; u < H; u++)
+            {
+                const uint64* row = Xs + c*hw + u*Wd;
+                for (int64_t j = 0; j < k; j++)
+                {
+                    Fp61Acc sum;
+                    for (int64_t x = 0; x < (int64_t) Wd; x++)
+                        if (x+j-pad >= 0 && x+j-pad < (int64_t) Wd)
+                            sum.addmul(row[x+j-pad], Ex[x]);
+                    T[(c*H + u)*K + j] = sum.value().v;
+                }
+            }
+            for (int64_t i = 0; i < k; i++)
+                for (int64_t j = 0; j < k; j++)
+                {
+                    Fp61Acc sum;
+                    for (int64_t y = 0; y < (int64_t) H; y++)
+                        if (y+i-pad >= 0 && y+i-pad < (int64_t) H)
+                            sum.addmul(T[(c*H + y+i-pad)*K + j], Ey[y]);
+                    A[(c*K + i)*K + j] = sum.value().canonical();
+                }
+        }
+    });
+
+    arena_release(scratch, mark);
+}
+
+/*
+ * shift_table:
+ *    fills out[u] = sum_{i < k} eq(ri, i) eq(zy, u-i+k/2) for the 2^vars
+ *    positions u of an axis of the input: how much input position u weighs
+ *    in the patches bound to ri (kv coordinates) and zy (vars coordinates).
+ */
+static void shift_table(uint64* ri, int kv, uint64* zy, int vars, int k,
+        uint64* out, arena* scratch)
+{
+    int64_t size = myPow(2, vars);
+    int64_t pad = k/2;
+    size_t mark = arena_mark(scratch);
+    uint64* Er = arena_words(scratch, myPow(2, kv));
+    uint64* Ez = arena_words(scratch, size);
+    eq_table(ri, kv, Er);
+    eq_table(zy, vars, Ez);
+    for (int64_t u = 0; u < size; u++)
+    {
+        Fp61Acc sum;
+        for (int64_t i = 0; i < k; i++)
+            if (u-i+pad >= 0 && u-i+pad < size)
+                sum.addmul(Er[i], Ez[u-i+pad]);
+        out[u] = sum.value().canonical();
+    }
+    arena_release(scratch, mark);
+}
+
+/*
+ * conv_input_table:
+ *    fills the table G of the e+d variables of one batch of the input of
+ *    layer l, such that P~(z_row, r) = sum_t X[t] G[t] for the patches P
+ *    of any batch X:
+ *
+ *      G[s, c, u, v] = eq(z_s, s) eq(r_c, c) shift_y[u] shift_x[v]
+ *
+ * Params:
+ *    const layer* l: the layer
+ *    uint64* r: the point of the kernel index, kv column, kv row and then
+ *               the channel coordinates
+ *    uint64* z: the point of the claim about the output (f column then e
+ *               sample coordinates)
+ *    uint64* G: receives the table, 2^(e+d) entries
+ *    arena* scratch: the arena the working tables are taken from
+ *
+ * Returns:
+ *    Nothing.
+ */
+void conv_input_table(const layer* l, uint64* r, uint64* z, uint64* G,
+        arena* scratch)
+{
+    int kv = conv_kernel_vars(l->k);
+    int cv = l->d - l->h - l->w;
+    uint64 hw = myPow(2, l->h + l->w);
+    uint64 Wd = myPow(2, l->w);
+
+    size_t mark = arena_mark(scratch);
+    uint64* Es = arena_words(scratch, myPow(2, l->e));
+    uint64* Ec = arena_words(scratch, myPow(2, cv));
+    uint64* Sy = arena_words(scratch, myPow(2, l->h));
+    uint64* Sx = arena_words(scratch, Wd);
+    eq_table(z + l->f, l->e, Es);
+    eq_table(r + 2*kv, cv, Ec);
+    shift_table(r + kv, kv, z + l->w, l->h, l->k, Sy, scratch);
+    shift_table(r, kv, z, l->w, l->k, Sx, scratch);
+    stats_count(myPow(2, l->e + l->d), myPow(2, l->e + l->d)*sizeof(uint64));
+
+    // a map of H x W is the product of the two shift tables, scaled by the
+    // eq of its sample and channel
+    parallel_for(myPow(2, l->e + cv), 1, [&](uint64 b, uint64 e, int) {
+        for (uint64 sc = b; sc < e; sc++)
+        {
+            uint64 w = myModMult(Es[sc >> cv], Ec[sc & (myPow(2, cv)-1)]);
+            uint64* out = G + sc*hw;
+            for (uint64 u = 0; u < hw/Wd; u++)
+            {
+                uint64 wu = myModMult(w, Sy[u]);
+                for (uint64 v = 0; v < Wd; v++)
+                    out[u*Wd + v] = myModMult(wu, Sx[v]);
+            }
+        }
+    });
+
+    arena_release(scratch, mark);
+}
+
+/*
+ * conv_input_eval:
+ *    returns G~(point) for the table G of conv_input_table, the verifier's
+ *    side of the reduction to the input, in O(H k + W k).
+ */
+uint64 conv_input_eval(const layer* l, uint64* r, uint64* z, uint64* point,
+        arena* scratch)
+{
+    int kv = conv_kernel_vars(l->k);
+    int cv = l->d - l->h - l->w;
+    uint64 H = myPow(2, l->h);
+    uint64 Wd = myPow(2, l->w);
+
+    size_t mark = arena_mark(scratch);
+    uint64* Sy = arena_words(scratch, H);
+    uint64* Sx = arena_words(scratch, Wd);
+    uint64* Ey = arena_words(scratch, H);
+    uint64* Ex = arena_words(scratch, Wd);
+    shift_table(r + kv, kv, z + l->w, l->h, l->k, Sy, scratch);
+    shift_table(r, kv, z, l->w, l->k, Sx, scratch);
+    eq_table(point + l->w, l->h, Ey);
+    eq_table(point, l->w, Ex);
+
+    Fp61Acc y, x;
+    for (uint64 u = 0; u < H; u++)
+        y.addmul(Sy[u], Ey[u]);
+    for (uint64 v = 0; v < Wd; v++)
+        x.addmul(Sx[v], Ex[v]);
+    uint64 ans = myModMult(y.value().v, x.value().v);
+    ans = myModMult(ans, evaluate_I(r + 2*kv, point + l->h + l->w, cv));
+    ans = myModMult(ans, evaluate_I(z + l->f, point + l->d, l->e));
+
+    arena_release(scratch, mark);
+    return myModCanon(ans);
+}
@@ -0,0 +1,29 @@
+/*
+ * conv module header file
+ *
+ * This module contains the convolutional layer: its forward pass and the
+ * tables the prover and the verifier build to prove it without expanding its
+ * kernel into a fully connected weight matrix.
+ */
+#ifndef CONV_H
+#define CONV_H
+
+#include "arena.h"
+#include "math.h"
+#include "model.h"
+
+/* for information on these functions, read conv.cc */
+int conv_kernel_vars(int k);
+int conv_weight_vars(int d, int k, int h, int w);
+size_t conv_scratch_bytes(int h, int w, int nthreads);
+size_t conv_tables_bytes(int e, int d, int k, int h, int w);
+void conv_forward(const void* X, int Xtype, const void* W, int Wtype,
+        uint64* Y, const layer* l, arena* scratch);
+void conv_bind_patches(const uint64* Xs, const layer* l, uint64* z,
+        uint64* A, arena* scratch);
+void conv_input_table(const layer* l, uint64* r, uint64* z, uint64* G,
+        arena* scratch);
+uint64 conv_input_eval(const layer* l, uint64* r, uint64* z, uint64* point,
+        arena* scratch);
+
+#endif // CONV_H
@@ -0,0 +1,214 @@
+/*
+ * gemm module
+ *
+ * This module contains a cache-blocked, multithreaded matrix multiplication
+ * over F_p, p = 2^61-1:
+ *
+ *   C[i*p+j] = sum_k A[i*n+k] * B[j*n+k]
+ *
+ * i.e. B holds one row of n weights per output neuron, as in the weight
+ * half of the layer array of verify_mm. The output is split into MC x NC
+ * tiles that the thread pool's workers claim one at a time. For each tile the k
+ * dimension is walked in panels of KC: the A and B rows of the panel are
+ * packed into contiguous per-thread buffers (which also avoids cache-set
+ * conflicts from the power-of-two row strides), lifting operands stored as
+ * narrow integers to field elements on the way, so that they are streamed
+ * from memory at their own width; then a 2x2 register-blocked
+ * micro-kernel sums raw 128-bit products over KR consecutive k before
+ * folding them into the tile's lazy accumulators. Only the final sum of
+ * each output is reduced mod p.
+ *
+ * Only the first n_true columns of A and B and the first p_true rows of B
+ * (the true sizes of a padded layer, see struct layer) are read: the rest
+ * is zero padding, and the columns of C past p_true are zeroed instead of
+ * computed.
+ */
+#include "gemm.h"
+#include "stats.h"
+#include "threadpool.h"
+
+#define GEMM_MC 32
+#define GEMM_NC 32
+#define GEMM_KC 256
+
+// number of raw products summed before a reduction; inputs are below
+// 2^61+8, so KR of them stay below 2^127
+#define GEMM_KR 32
+
+/*
+ * micro_kernel:
+ *    adds the products of the mr x kc packed panel pa and the nr x kc
+ *    packed panel pb (mr, nr <= 2) to the lazy accumulators acc, whose rows
+ *    are ldacc apart.
+ */
+static void micro_kernel(const uint64* pa, const uint64* pb, uint64 kc,
+        uint64 mr, uint64 nr, uint128* acc, uint64 ldacc)
+{
+    if (mr == 2 && nr == 2)
+    {
+        const uint64* a0 = pa;
+        const uint64* a1 = pa + kc;
+        const uint64* b0 = pb;
+        const uint64* b1 = pb + kc;
+        for (uint64 k0 = 0; k0 < kc; k0 += GEMM_KR)
+        {
+            uint64 k1 = (k0 + GEMM_KR < kc) ? k0 + GEMM_KR : kc;
+            uint128 c00 = 0; uint128 c01 = 0; uint128 c10 = 0; uint128 c11 = 0;
+            for (uint64 k = k0; k < k1; k++)
+            {
+                c00 += (uint128)a0[k] * b0[k];
+                c01 += (uint128)a0[k] * b1[k];
+                c10 += (uint128)a1[k] * b0[k];
+                c11 += (uint128)a1[k] * b1[k];
+            }
+            acc[0] += myModReduce(c00);
+            acc[1] += myModReduce(c01);
+            acc[ldacc] += myModReduce(c10);
+            acc[ldacc+1] += myModReduce(c11);
+        }
+        return;
+    }
+
+    for (uint64 r = 0; r < mr; r++)
+    {
+        for (uint64 c = 0; c < nr; c++)
+        {
+            for (uint64 k0 = 0; k0 < kc; k0 += GEMM_KR)
+            {
+                uint64 k1 = (k0 + GEMM_KR < kc) ? k0 + GEMM_KR : kc;
+                uint128 s = 0;
+                for (uint64 k = k0; k < k1; k++)
+                    s += (uint128)pa[r*kc+k] * pb[c*kc+k];
+                acc[r*ldacc+c] += myModReduce(s);
+            }
+        }
+    }
+}
+
+/*
+ * pack_panel:
+ *    copies rows [row0, row0+rows) x columns [k0, k0+kc) of the row-major
+ *    matrix M (row length n, storage type type) into the contiguous buffer
+ *    out, as field elements.
+ */
+static void pack_panel(const void* M, int type, uint64 n, uint64 row0,
+        uint64 rows, uint64 k0, uint64 kc, uint64* out)
+{
+    for (uint64 r = 0; r < rows; r++)
+    {
+        const void* src = elem_at(M, type, (row0 + r)*n + k0);
+        uint64* dst = out + r*kc;
+        if (type == ELEM_I8)
+            for (uint64 k = 0; k < kc; k++)
+                dst[k] = myLift(((const int8_t*) src)[k]);
+        else if (type == ELEM_I16)
+            for (uint64 k = 0; k < kc; k++)
+                dst[k] = myLift(((const int16_t*) src)[k]);
+        else
+            for (uint64 k = 0; k < kc; k++)
+                dst[k] = ((const uint64*) src)[k];
+    }
+}
+
+/*
+ * gemm_tile:
+ *    computes output tile number tile into C, using the packing buffers pa
+ *    and pb and the MC x NC accumulators acc.
+ */
+static void gemm_tile(const void* A, int Atype, const void* B, int Btype,
+        uint64* C, uint64 m, uint64 n, uint64 p, uint64 n_true, uint64 p_true,
+        uint64 tile, uint64* pa, uint64* pb, uint128* acc)
+{
+    uint64 tiles_p = (p_true + GEMM_NC - 1)/GEMM_NC;
+    uint64 i0 = (tile / tiles_p)*GEMM_MC;
+    uint64 j0 = (tile % tiles_p)*GEMM_NC;
+    uint64 mc = (m - i0 < GEMM_MC) ? m - i0 : GEMM_MC;
+    uint64 nc = (p_true - j0 < GEMM_NC) ? p_true - j0 : GEMM_NC;
+
+    for (uint64 t = 0; t < GEMM_MC*GEMM_NC; t++)
+        acc[t] = 0;
+
+    for (uint64 k0 = 0; k0 < n_true; k0 += GEMM_KC)
+    {
+        uint64 kc = (n_true - k0 < GEMM_KC) ? n_true - k0 : GEMM_KC;
+        pack_panel(A, Atype, n, i0, mc, k0, kc, pa);
+        pack_panel(B, Btype, n, j0, nc, k0, kc, pb);
+
+        for (uint64 r = 0; r < mc; r += 2)
+        {
+            uint64 mr = (mc - r < 2) ? mc - r : 2;
+            for (uint64 c = 0; c < nc; c += 2)
+            {
+                uint64 nr = (nc - c < 2) ? nc - c : 2;
+                micro_kernel(pa + r*kc, pb + c*kc, kc, mr, nr,
+                        acc + r*GEMM_NC + c, GEMM_NC);
+            }
+        }
+    }
+
+    for (uint64 r = 0; r < mc; r++)
+    {
+        for (uint64 c = 0; c < nc; c++)
+            C[(i0+r)*p + j0+c] = myModCanon(myModReduce(acc[r*GEMM_NC+c]));
+        // the last tile of a row of tiles clears the padding columns
+        if (j0 + nc == p_true)
+            for (uint64 j = p_true; j < p; j++)
+                C[(i0+r)*p + j] = 0;
+    }
+}
+
+/*
+ * gemm_scratch_bytes:
+ *    returns the arena footprint of gemm_mod on nthreads threads.
+ */
+size_t gemm_scratch_bytes(int nthreads)
+{
+    return arena_words_bytes(nthreads*GEMM_MC*GEMM_KC) +
+           arena_words_bytes(nthreads*GEMM_NC*GEMM_KC) +
+           arena_bytes(nthreads*GEMM_MC*GEMM_NC*sizeof(uint128));
+}
+
+/*
+ * gemm_mod:
+ *    computes C = A * B^T over F_p on the thread pool.
+ *
+ * Params:
+ *    const void* A: m x n matrix, row-major; field elements below 2^61+8
+ *                   or narrow integers
+ *    int Atype: the storage type of A
+ *    const void* B: p x n matrix, row-major, like A
+ *    int Btype: the storage type of B
+ *    uint64* C: receives the m x p product, row-major, canonical
+ *    uint64 m, n, p: the dimensions
+ *    uint64 n_true, p_true: the true sizes, n_true <= n and p_true <= p;
+ *                           the entries of A and B past them are zero
+ *    arena* scratch: the arena the working buffers are taken from, see
+ *                    gemm_scratch_bytes
+ *
+ * Returns:
+ *    Nothing.
+ */
+void gemm_mod(const void* A, int Atype, const void* B, int Btype, uint64* C,
+        uint64 m, uint64 n, uint64 p, uint64 n_true, uint64 p_true,
+        arena* scratch)
+{
+    stats_count(m*n_true*p_true, m*n_true*elem_bytes(Atype) +
+            p_true*n_true*elem_bytes(Btype) + m*p*sizeof(uint64));
+    int nthreads = threadpool_size();
+    size_t mark = arena_mark(scratch);
+    uint64* pa = arena_words(scratch, nthreads*GEMM_MC*GEMM_KC);
+    uint64* pb = arena_words(scratch, nthreads*GEMM_NC*GEMM_KC);
+    uint128* acc = (uint128*) arena_alloc(scratch,
+            nthreads*GEMM_MC*GEMM_NC*sizeof(uint128));
+
+    uint64 tiles = ((m + GEMM_MC - 1)/GEMM_MC) *
+                   ((p_true + GEMM_NC - 1)/GEMM_NC);
+    parallel_for(tiles, 1, [&](uint64 b, uint64 e, int id) {
+        for (uint64 tile = b; tile < e; tile++)
+            gemm_tile(A, Atype, B, Btype, C, m, n, p, n_true, p_true, tile,
+                    pa + id*GEMM_MC*GEMM_KC, pb + id*GEMM_NC*GEMM_KC,
+                    acc + id*GEMM_MC*GEMM_NC);
+    });
+
+    arena_release(scratch, mark);
+}
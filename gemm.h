@@ -0,0 +1,19 @@
+/*
+ * gemm module header file
+ *
+ * This module contains the modular matrix multiplication that computes the
+ * (unverifiable) output of a fully connected layer.
+ */
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "arena.h"
+#include "math.h"
+
+/* for information on these functions, read gemm.cc */
+size_t gemm_scratch_bytes(int nthreads);
+void gemm_mod(const void* A, int Atype, const void* B, int Btype, uint64* C,
+        uint64 m, uint64 n, uint64 p, uint64 n_true, uint64 p_true,
+        arena* scratch);
+
+#endif // GEMM_H
@@ -0,0 +1,397 @@
+/*
+ * kernels module
+ *
+ * This module contains the vectorized element-wise kernels of the sum-check
+ * prover. Field elements mod 2^61-1 are kept one per 64-bit lane; products
+ * are assembled from 32x32->64 partial products, which is the widest
+ * unsigned multiply both AVX2 and AVX-512F provide:
+ *
+ *   x*y = hh*2^64 + mid*2^32 + ll,  with 2^64 = 8 and 2^61 = 1 (mod p)
+ *
+ * so mid*2^32 = (mid >> 29) + ((mid & (2^29-1)) << 32) (mod p). For lane
+ * inputs below 2^62 every intermediate fits in 64 bits and the result is
+ * reduced the same way myModMult reduces it (below p+8).
+ *
+ * Every kernel has an AVX-512, an AVX2 and a scalar path (kernels_isa.h),
+ * all compiled into the same binary; the widest one the CPU supports is
+ * picked once, when the program is loaded, and kernels_path tells which.
+ */
+#include <cstring>
+#include <iostream>
+
+#include "kernels.h"
+#include "stats.h"
+#include "threadpool.h"
+
+#define MASK29 536870911 //2^29-1
+
+// the vector paths are compiled with the target options of their
+// instruction set, whatever the flags of the build, and only run on a CPU
+// that has it; everything outside them stays portable
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace generic {
+#define VEC_WIDTH 1
+#include "kernels_isa.h"
+#undef VEC_WIDTH
+}
+
+#ifdef KERNELS_X86
+#pragma GCC push_options
+#pragma GCC target("avx2,bmi2")
+namespace avx2 {
+#define VEC_WIDTH 4
+#include "kernels_isa.h"
+#undef VEC_WIDTH
+}
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,bmi2")
+namespace avx512 {
+#define VEC_WIDTH 8
+#include "kernels_isa.h"
+#undef VEC_WIDTH
+}
+#pragma GCC pop_options
+#endif
+
+// the kernels of one instruction set
+struct kernel_path {
+    const char* name;
+    void (*fold)(uint64*, const uint64*, const uint64*, uint64, uint64);
+    void (*round_sums)(const uint64*, const uint64*, const uint64*,
+            const uint64*, uint64, uint64*);
+    void (*sqr_sums)(const uint64*, const uint64*, uint64, uint64*);
+    void (*scale_add)(uint64*, const uint64*, uint64, uint64);
+    void (*scale_add_lift)(uint64*, const void*, int, uint64, uint64);
+};
+
+// widest first
+static const kernel_path paths[] = {
+#ifdef KERNELS_X86
+    {"avx512", avx512::fold_kernel, avx512::round_sums_kernel,
+        avx512::sqr_sums_kernel, avx512::scale_add_kernel,
+        avx512::scale_add_lift_kernel},
+    {"avx2", avx2::fold_kernel, avx2::round_sums_kernel,
+        avx2::sqr_sums_kernel, avx2::scale_add_kernel,
+        avx2::scale_add_lift_kernel},
+#endif
+    {"generic", generic::fold_kernel, generic::round_sums_kernel,
+        generic::sqr_sums_kernel, generic::scale_add_kernel,
+        generic::scale_add_lift_kernel},
+};
+
+/*
+ * path_supported:
+ *    returns whether the CPU (and the operating system, which must save the
+ *    wider registers) can run path.
+ */
+static bool path_supported(const kernel_path* path)
+{
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+    if (strcmp(path->name, "avx512") == 0)
+        return __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx2") &&
+               __builtin_cpu_supports("bmi2");
+    if (strcmp(path->name, "avx2") == 0)
+        return __builtin_cpu_supports("avx2") &&
+               __builtin_cpu_supports("bmi2");
+#endif
+    return true;
+}
+
+/*
+ * select_path:
+ *    returns the widest path the CPU supports, or the one named by the
+ *    environment variable SAFETYNETS_KERNELS (generic, avx2 or avx512),
+ *    which is how the narrower paths are tested on a wide CPU.
+ *
+ * Returns:
+ *    const kernel_path*: the path. A path asked for that is unknown or not
+ *    supported is reported, and the widest supported one is used instead:
+ *    this runs while the program (or the library) is loaded, which must
+ *    not fail.
+ */
+static const kernel_path* select_path()
+{
+    const char* name = getenv("SAFETYNETS_KERNELS");
+    int count = sizeof(paths)/sizeof(paths[0]);
+    // the paths go from the widest to generic, which runs anywhere
+    int widest = 0;
+    while (!path_supported(&paths[widest]))
+        widest++;
+    if (name == NULL)
+        return &paths[widest];
+
+    for (int i = 0; i < count; i++)
+        if (strcmp(name, paths[i].name) == 0 && path_supported(&paths[i]))
+            return &paths[i];
+    std::cout << "The kernels " << name << " are unknown or cannot run on"
+              << " this CPU; using " << paths[widest].name << std::endl;
+    return &paths[widest];
+}
+
+// picked once, when the program (or the library) is loaded
+static const kernel_path* path = select_path();
+
+/*
+ * kernels_path:
+ *    returns the name of the instruction set the kernels run on: avx512,
+ *    avx2 or generic.
+ */
+const char* kernels_path()
+{
+    return path->name;
+}
+
+/*
+ * fold_kernel:
+ *    binds the high-order variable of a table to r: out[i] = lo[i](1-r) +
+ *    hi[i]r for i < len, where lo and hi are the x = 0 and x = 1 halves of
+ *    the table (for a table V of length 2h, lo = V and hi = V+h). out may be
+ *    lo itself, which folds in place.
+ *
+ * Params:
+ *    uint64* out: receives the len folded values
+ *    const uint64* lo: the x = 0 half
+ *    const uint64* hi: the x = 1 half
+ *    uint64 len: the length of each half
+ *    uint64 r: the value to bind the variable to
+ *
+ * Returns:
+ *    Nothing.
+ */
+void fold_kernel(uint64* out, const uint64* lo, const uint64* hi, uint64 len,
+        uint64 r)
+{
+    path->fold(out, lo, hi, len, r);
+}
+
+/*
+ * round_sums_kernel:
+ *    computes the evaluations at 0, 1 and 2 of the round polynomial of a
+ *    sum-check over the product of two multilinear tables a and b whose
+ *    high-order variable is the one being summed over. Each table is given
+ *    as its x = 0 and x = 1 halves.
+ *
+ * Params:
+ *    const uint64* a_lo, a_hi: the halves of the first table
+ *    const uint64* b_lo, b_hi: the halves of the second table
+ *    uint64 len: the length of each half
+ *    uint64* sums: output, sums[0..2] receive the three evaluations (not
+ *                  necessarily canonical)
+ *
+ * Returns:
+ *    Nothing.
+ */
+void round_sums_kernel(const uint64* a_lo, const uint64* a_hi,
+        const uint64* b_lo, const uint64* b_hi, uint64 len, uint64* sums)
+{
+    path->round_sums(a_lo, a_hi, b_lo, b_hi, len, sums);
+}
+
+/*
+ * sqr_sums_kernel:
+ *    computes the evaluations at 0, 1, 2 and 3 of the round polynomial of a
+ *    sum-check over I V^2, I and V multilinear tables whose low-order
+ *    variable is the one being summed over: the pairs (2k, 2k+1) of each
+ *    table are its x = 0 and x = 1 entries. This is the degree-3 round of
+ *    the square activation.
+ *
+ * Params:
+ *    const uint64* I: the first table, 2*len entries
+ *    const uint64* V: the table that is squared, 2*len entries
+ *    uint64 len: the number of pairs
+ *    uint64* sums: output, sums[0..3] receive the four evaluations (not
+ *                  necessarily canonical)
+ *
+ * Returns:
+ *    Nothing.
+ */
+void sqr_sums_kernel(const uint64* I, const uint64* V, uint64 len,
+        uint64* sums)
+{
+    path->sqr_sums(I, V, len, sums);
+}
+
+/*
+ * scale_add_kernel:
+ *    acc[i] += w*x[i] for i < len. acc stays reduced (below p+8), so it can
+ *    absorb any number of calls.
+ *
+ * Params:
+ *    uint64* acc: the accumulators
+ *    const uint64* x: the values to scale
+ *    uint64 w: the scale
+ *    uint64 len: the number of entries
+ *
+ * Returns:
+ *    Nothing.
+ */
+void scale_add_kernel(uint64* acc, const uint64* x, uint64 w, uint64 len)
+{
+    path->scale_add(acc, x, w, len);
+}
+
+/*
+ * scale_add_lift_kernel:
+ *    scale_add_kernel on a tensor x of storage type type: narrow entries are
+ *    lifted to F_p as they are loaded, so x is read at its own width.
+ *
+ * Params:
+ *    uint64* acc: the accumulators
+ *    const void* x: the values to scale
+ *    int type: the storage type of x (ELEM_U64, ELEM_I8 or ELEM_I16)
+ *    uint64 w: the scale
+ *    uint64 len: the number of entries
+ *
+ * Returns:
+ *    Nothing.
+ */
+void scale_add_lift_kernel(uint64* acc, const void* x, int type, uint64 w,
+        uint64 len)
+{
+    path->scale_add_lift(acc, x, type, w, len);
+}
+
+/*
+ * fold_parallel:
+ *    fold_kernel, split across the thread pool.
+ */
+void fold_parallel(uint64* out, const uint64* lo, const uint64* hi,
+        uint64 len, uint64 r)
+{
+    stats_count(len, 3*len*sizeof(uint64));
+    parallel_for(len, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int) {
+        fold_kernel(out + b, lo + b, hi + b, e - b, r);
+    });
+}
+
+/*
+ * combine_parallel:
+ *    out[i] = sum_t w[t] V[t*n + i] for i < n: the weighted sum of count
+ *    tables of n entries laid out one after another, split across the
+ *    thread pool.
+ */
+void combine_parallel(uint64* out, const uint64* V, uint64 n,
+        const uint64* w, int count)
+{
+    stats_count(count*n, (count + 1)*n*sizeof(uint64));
+    parallel_for(n, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int) {
+        for (uint64 i = b; i < e; i++)
+            out[i] = 0;
+        for (int t = 0; t < count; t++)
+            scale_add_kernel(out + b, V + t*n + b, w[t], e - b);
+    });
+}
+
+/*
+ * round_sums_bytes:
+ *    returns the arena footprint of round_sums_parallel and
+ *    round_sums_rows_parallel.
+ */
+size_t round_sums_bytes()
+{
+    return arena_words_bytes(3*threadpool_size());
+}
+
+/*
+ * round_sums_parallel:
+ *    round_sums_kernel, split across the thread pool. Every thread keeps its
+ *    own partial sums, allocated from scratch, which are combined once at
+ *    the end.
+ */
+void round_sums_parallel(const uint64* a_lo, const uint64* a_hi,
+        const uint64* b_lo, const uint64* b_hi, uint64 len, uint64* sums,
+        arena* scratch)
+{
+    stats_count(3*len, 4*len*sizeof(uint64));
+    int nthreads = threadpool_size();
+    size_t mark = arena_mark(scratch);
+    uint64* partial = arena_zeros(scratch, 3*nthreads);
+    parallel_for(len, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int id) {
+        uint64 chunk[3];
+        round_sums_kernel(a_lo + b, a_hi + b, b_lo + b, b_hi + b, e - b,
+                chunk);
+        for (int k = 0; k < 3; k++)
+            partial[3*id+k] = myMod(partial[3*id+k] + chunk[k]);
+    });
+
+    for (int k = 0; k < 3; k++)
+    {
+        Fp61Acc acc;
+        for (int t = 0; t < nthreads; t++)
+            acc.add(partial[3*t+k]);
+        sums[k] = acc.value().v;
+    }
+    arena_release(scratch, mark);
+}
+
+/*
+ * fold_rows_parallel:
+ *    fold_kernel on the first len entries of rows rows of a table laid out
+ *    stride entries apart, split across the thread pool by rows. The rest of
+ *    every row is left as it is, which is how the known-zero padding at the
+ *    end of the rows is skipped.
+ */
+void fold_rows_parallel(uint64* out, const uint64* lo, const uint64* hi,
+        uint64 rows, uint64 stride, uint64 len, uint64 r)
+{
+    if (rows == 1)
+    {
+        fold_parallel(out, lo, hi, len, r);
+        return;
+    }
+    stats_count(rows*len, 3*rows*len*sizeof(uint64));
+    parallel_for(rows, PARALLEL_GRAIN/len + 1, [&](uint64 b, uint64 e, int) {
+        for (uint64 row = b; row < e; row++)
+            fold_kernel(out + row*stride, lo + row*stride, hi + row*stride,
+                    len, r);
+    });
+}
+
+/*
+ * round_sums_rows_parallel:
+ *    round_sums_kernel summed over the first len entries of rows rows of the
+ *    tables, laid out stride entries apart, split across the thread pool by
+ *    rows.
+ */
+void round_sums_rows_parallel(const uint64* a_lo, const uint64* a_hi,
+        const uint64* b_lo, const uint64* b_hi, uint64 rows, uint64 stride,
+        uint64 len, uint64* sums, arena* scratch)
+{
+    if (rows == 1)
+    {
+        round_sums_parallel(a_lo, a_hi, b_lo, b_hi, len, sums, scratch);
+        return;
+    }
+    stats_count(3*rows*len, 4*rows*len*sizeof(uint64));
+    int nthreads = threadpool_size();
+    size_t mark = arena_mark(scratch);
+    uint64* partial = arena_zeros(scratch, 3*nthreads);
+    parallel_for(rows, PARALLEL_GRAIN/len + 1, [&](uint64 b, uint64 e, int id) {
+        uint64 chunk[3];
+        for (uint64 row = b; row < e; row++)
+        {
+            uint64 o = row*stride;
+            round_sums_kernel(a_lo + o, a_hi + o, b_lo + o, b_hi + o, len,
+                    chunk);
+            for (int k = 0; k < 3; k++)
+                partial[3*id+k] = myMod(partial[3*id+k] + chunk[k]);
+        }
+    });
+
+    for (int k = 0; k < 3; k++)
+    {
+        Fp61Acc acc;
+        for (int t = 0; t < nthreads; t++)
+            acc.add(partial[3*t+k]);
+        sums[k] = acc.value().v;
+    }
+    arena_release(scratch, mark);
+}
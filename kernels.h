@@ -0,0 +1,44 @@
+/*
+ * kernels module header file
+ *
+ * This module contains the element-wise modular kernels the sum-check
+ * prover spends its time in: folding a table on a random challenge and
+ * accumulating the per-round evaluations of the round polynomial. Each
+ * kernel has an AVX-512, an AVX2 and a scalar implementation, all compiled
+ * in; the one run is picked from the CPU at startup. The _parallel
+ * variants split the work across the thread pool.
+ */
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+
+#include "arena.h"
+#include "math.h"
+
+/* for information on these functions, read kernels.cc */
+const char* kernels_path();
+void fold_kernel(uint64* out, const uint64* lo, const uint64* hi, uint64 len,
+        uint64 r);
+void round_sums_kernel(const uint64* a_lo, const uint64* a_hi,
+        const uint64* b_lo, const uint64* b_hi, uint64 len, uint64* sums);
+void sqr_sums_kernel(const uint64* I, const uint64* V, uint64 len,
+        uint64* sums);
+void scale_add_kernel(uint64* acc, const uint64* x, uint64 w, uint64 len);
+void scale_add_lift_kernel(uint64* acc, const void* x, int type, uint64 w,
+        uint64 len);
+void fold_parallel(uint64* out, const uint64* lo, const uint64* hi,
+        uint64 len, uint64 r);
+void combine_parallel(uint64* out, const uint64* V, uint64 n,
+        const uint64* w, int count);
+size_t round_sums_bytes();
+void round_sums_parallel(const uint64* a_lo, const uint64* a_hi,
+        const uint64* b_lo, const uint64* b_hi, uint64 len, uint64* sums,
+        arena* scratch);
+void fold_rows_parallel(uint64* out, const uint64* lo, const uint64* hi,
+        uint64 rows, uint64 stride, uint64 len, uint64 r);
+void round_sums_rows_parallel(const uint64* a_lo, const uint64* a_hi,
+        const uint64* b_lo, const uint64* b_hi, uint64 rows, uint64 stride,
+        uint64 len, uint64* sums, arena* scratch);
+
+#endif // KERNELS_H
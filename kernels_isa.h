@@ -0,0 +1,284 @@
+/*
+ * kernels instruction set body
+ *
+ * This file holds the element-wise kernels of kernels.cc for one vector
+ * width, VEC_WIDTH: 8 lanes (AVX-512F), 4 (AVX2) or 1 (scalar). It is not a
+ * header of its own: kernels.cc includes it once per path, inside the
+ * namespace of the path and the target options of its instruction set, so
+ * that every path is compiled into the same portable binary and picked at
+ * run time. The kernels are documented on their public entry points, in
+ * kernels.cc.
+ */
+
+#if VEC_WIDTH == 8
+
+typedef __m512i vec;
+
+static inline vec vec_load(const uint64* p) { return _mm512_loadu_si512(p); }
+static inline void vec_store(uint64* p, vec x) { _mm512_storeu_si512(p, x); }
+static inline vec vec_set1(uint64 x) { return _mm512_set1_epi64(x); }
+static inline vec vec_add(vec x, vec y) { return _mm512_add_epi64(x, y); }
+static inline vec vec_sub(vec x, vec y) { return _mm512_sub_epi64(x, y); }
+static inline vec vec_and(vec x, vec y) { return _mm512_and_si512(x, y); }
+static inline vec vec_mul32(vec x, vec y) { return _mm512_mul_epu32(x, y); }
+static inline vec vec_unpacklo(vec x, vec y)
+{
+    return _mm512_unpacklo_epi64(x, y);
+}
+static inline vec vec_unpackhi(vec x, vec y)
+{
+    return _mm512_unpackhi_epi64(x, y);
+}
+static inline vec vec_load_i8(const int8_t* p)
+{
+    return _mm512_cvtepi8_epi64(_mm_loadl_epi64((const __m128i*) p));
+}
+static inline vec vec_load_i16(const int16_t* p)
+{
+    return _mm512_cvtepi16_epi64(_mm_loadu_si128((const __m128i*) p));
+}
+#define vec_srli(x, n) _mm512_srli_epi64((x), (n))
+#define vec_slli(x, n) _mm512_slli_epi64((x), (n))
+
+#elif VEC_WIDTH == 4
+
+typedef __m256i vec;
+
+static inline vec vec_load(const uint64* p)
+{
+    return _mm256_loadu_si256((const __m256i*) p);
+}
+static inline void vec_store(uint64* p, vec x)
+{
+    _mm256_storeu_si256((__m256i*) p, x);
+}
+static inline vec vec_set1(uint64 x) { return _mm256_set1_epi64x(x); }
+static inline vec vec_add(vec x, vec y) { return _mm256_add_epi64(x, y); }
+static inline vec vec_sub(vec x, vec y) { return _mm256_sub_epi64(x, y); }
+static inline vec vec_and(vec x, vec y) { return _mm256_and_si256(x, y); }
+static inline vec vec_mul32(vec x, vec y) { return _mm256_mul_epu32(x, y); }
+static inline vec vec_unpacklo(vec x, vec y)
+{
+    return _mm256_unpacklo_epi64(x, y);
+}
+static inline vec vec_unpackhi(vec x, vec y)
+{
+    return _mm256_unpackhi_epi64(x, y);
+}
+static inline vec vec_load_i8(const int8_t* p)
+{
+    int32_t w;
+    memcpy(&w, p, sizeof(w));
+    return _mm256_cvtepi8_epi64(_mm_cvtsi32_si128(w));
+}
+static inline vec vec_load_i16(const int16_t* p)
+{
+    return _mm256_cvtepi16_epi64(_mm_loadl_epi64((const __m128i*) p));
+}
+#define vec_srli(x, n) _mm256_srli_epi64((x), (n))
+#define vec_slli(x, n) _mm256_slli_epi64((x), (n))
+
+#endif
+
+#if VEC_WIDTH > 1
+
+// lane-wise myMod
+static inline vec vec_mod(vec x)
+{
+    return vec_add(vec_srli(x, 61), vec_and(x, vec_set1(PRIME)));
+}
+
+// lane-wise myModMult, for lanes below 2^62
+static inline vec vec_mult(vec x, vec y)
+{
+    vec xh = vec_srli(x, 32);
+    vec yh = vec_srli(y, 32);
+    vec hh = vec_mul32(xh, yh);
+    vec mid = vec_add(vec_mul32(xh, y), vec_mul32(x, yh));
+    vec ll = vec_mul32(x, y);
+
+    vec t = vec_add(vec_slli(hh, 3), vec_srli(mid, 29));
+    t = vec_add(t, vec_slli(vec_and(mid, vec_set1(MASK29)), 32));
+    t = vec_add(t, vec_mod(ll));
+    return vec_mod(t);
+}
+
+// lane-wise myMod(2*y + 2*PRIME - x): the round polynomial at point 2
+static inline vec vec_extend2(vec x, vec y)
+{
+    return vec_mod(vec_sub(vec_add(vec_add(y, y), vec_set1(2*PRIME)), x));
+}
+
+// lane-wise myMod(3*y + 4*PRIME - 2*x): the round polynomial at point 3
+static inline vec vec_extend3(vec x, vec y)
+{
+    vec y3 = vec_add(vec_add(y, y), y);
+    return vec_mod(vec_sub(vec_add(y3, vec_set1(4*PRIME)), vec_add(x, x)));
+}
+
+// the x = 0 and x = 1 entries of the VEC_WIDTH pairs at p, lane for lane
+static inline void vec_load_pairs(const uint64* p, vec* x0, vec* x1)
+{
+    vec a = vec_load(p);
+    vec b = vec_load(p + VEC_WIDTH);
+    *x0 = vec_unpacklo(a, b);
+    *x1 = vec_unpackhi(a, b);
+}
+
+// lane-wise lift of sign-extended narrow integers: x + p is congruent to x
+// and below 2^62 for |x| < 2^15, which is all vec_mult needs
+static inline vec vec_lift(vec x)
+{
+    return vec_add(x, vec_set1(PRIME));
+}
+
+// adds the lanes of x into the scalar accumulator acc
+static inline void vec_hsum(vec x, Fp61Acc& acc)
+{
+    uint64 lanes[VEC_WIDTH];
+    vec_store(lanes, x);
+    for (int l = 0; l < VEC_WIDTH; l++)
+        acc.add(lanes[l]);
+}
+
+#endif
+
+static void fold_kernel(uint64* out, const uint64* lo, const uint64* hi,
+        uint64 len, uint64 r)
+{
+    uint64 i = 0;
+#if VEC_WIDTH > 1
+    vec vr = vec_set1(r);
+    vec p2 = vec_set1(2*PRIME);
+    for (; i + VEC_WIDTH <= len; i += VEC_WIDTH)
+    {
+        vec l = vec_load(lo + i);
+        vec h = vec_load(hi + i);
+        vec diff = vec_mod(vec_sub(vec_add(h, p2), l));
+        vec_store(out + i, vec_mod(vec_add(l, vec_mult(vr, diff))));
+    }
+#endif
+    for (; i < len; i++)
+        out[i] = myMod(lo[i] + myModMult(r, myMod(hi[i] + 2*PRIME - lo[i])));
+}
+
+static void round_sums_kernel(const uint64* a_lo, const uint64* a_hi,
+        const uint64* b_lo, const uint64* b_hi, uint64 len, uint64* sums)
+{
+    Fp61Acc temp0; Fp61Acc temp1; Fp61Acc cross;
+    uint64 i = 0;
+#if VEC_WIDTH > 1
+    vec acc0 = vec_set1(0);
+    vec acc1 = vec_set1(0);
+    vec acc2 = vec_set1(0);
+    for (; i + VEC_WIDTH <= len; i += VEC_WIDTH)
+    {
+        vec a0 = vec_load(a_lo + i);
+        vec a1 = vec_load(a_hi + i);
+        vec b0 = vec_load(b_lo + i);
+        vec b1 = vec_load(b_hi + i);
+
+        acc0 = vec_mod(vec_add(acc0, vec_mult(a0, b0)));
+        acc1 = vec_mod(vec_add(acc1, vec_mult(a1, b1)));
+        acc2 = vec_mod(vec_add(acc2,
+                    vec_mult(vec_extend2(a0, a1), vec_extend2(b0, b1))));
+    }
+    vec_hsum(acc0, temp0);
+    vec_hsum(acc1, temp1);
+    vec_hsum(acc2, cross);
+#endif
+    for (; i < len; i++)
+    {
+        temp0.addmul(a_lo[i], b_lo[i]);
+        temp1.addmul(a_hi[i], b_hi[i]);
+        cross.addmul(myMod(2*a_hi[i] + 2*PRIME - a_lo[i]),
+                     myMod(2*b_hi[i] + 2*PRIME - b_lo[i]));
+    }
+    sums[0] = temp0.value().v;
+    sums[1] = temp1.value().v;
+    sums[2] = cross.value().v;
+}
+
+static void sqr_sums_kernel(const uint64* I, const uint64* V, uint64 len,
+        uint64* sums)
+{
+    Fp61Acc acc[4];
+    uint64 k = 0;
+#if VEC_WIDTH > 1
+    vec s[4] = {vec_set1(0), vec_set1(0), vec_set1(0), vec_set1(0)};
+    for (; k + VEC_WIDTH <= len; k += VEC_WIDTH)
+    {
+        vec i0, i1, v0, v1;
+        vec_load_pairs(I + 2*k, &i0, &i1);
+        vec_load_pairs(V + 2*k, &v0, &v1);
+        vec im[4] = {i0, i1, vec_extend2(i0, i1), vec_extend3(i0, i1)};
+        vec vm[4] = {v0, v1, vec_extend2(v0, v1), vec_extend3(v0, v1)};
+        for (int m = 0; m < 4; m++)
+            s[m] = vec_mod(vec_add(s[m],
+                        vec_mult(im[m], vec_mult(vm[m], vm[m]))));
+    }
+    for (int m = 0; m < 4; m++)
+        vec_hsum(s[m], acc[m]);
+#endif
+    for (; k < len; k++)
+    {
+        uint64 i0 = I[2*k], i1 = I[2*k+1];
+        uint64 v0 = V[2*k], v1 = V[2*k+1];
+        uint64 im[4] = {i0, i1, myMod(2*i1 + 2*PRIME - i0),
+                        myMod(3*i1 + 4*PRIME - 2*i0)};
+        uint64 vm[4] = {v0, v1, myMod(2*v1 + 2*PRIME - v0),
+                        myMod(3*v1 + 4*PRIME - 2*v0)};
+        for (int m = 0; m < 4; m++)
+            acc[m].addmul(im[m], myModMult(vm[m], vm[m]));
+    }
+    for (int m = 0; m < 4; m++)
+        sums[m] = acc[m].value().v;
+}
+
+static void scale_add_kernel(uint64* acc, const uint64* x, uint64 w,
+        uint64 len)
+{
+    uint64 i = 0;
+#if VEC_WIDTH > 1
+    vec vw = vec_set1(w);
+    for (; i + VEC_WIDTH <= len; i += VEC_WIDTH)
+    {
+        vec a = vec_load(acc + i);
+        vec_store(acc + i, vec_mod(vec_add(a, vec_mult(vw, vec_load(x + i)))));
+    }
+#endif
+    for (; i < len; i++)
+        acc[i] = myMod(acc[i] + myModMult(w, x[i]));
+}
+
+static void scale_add_lift_kernel(uint64* acc, const void* x, int type,
+        uint64 w, uint64 len)
+{
+    if (type == ELEM_U64)
+    {
+        scale_add_kernel(acc, (const uint64*) x, w, len);
+        return;
+    }
+
+    const int8_t* x8 = (const int8_t*) x;
+    const int16_t* x16 = (const int16_t*) x;
+    uint64 i = 0;
+#if VEC_WIDTH > 1
+    vec vw = vec_set1(w);
+    for (; i + VEC_WIDTH <= len; i += VEC_WIDTH)
+    {
+        vec v = vec_lift((type == ELEM_I8) ? vec_load_i8(x8 + i) :
+                                             vec_load_i16(x16 + i));
+        vec a = vec_load(acc + i);
+        vec_store(acc + i, vec_mod(vec_add(a, vec_mult(vw, v))));
+    }
+#endif
+    for (; i < len; i++)
+    {
+        uint64 v = (type == ELEM_I8) ? myLift(x8[i]) : myLift(x16[i]);
+        acc[i] = myMod(acc[i] + myModMult(w, v));
+    }
+}
+
+#undef vec_srli
+#undef vec_slli
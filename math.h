@@ -17,43 +17,217 @@
 #include <fstream>
 
 #include <sstream>
+#include <stdint.h>
 #include <vector>
 
-#define MASK 4294967295 //2^32-1
 #define PRIME 2305843009213693951 //2^61-1
 
 typedef unsigned long long uint64;
+typedef unsigned __int128 uint128;
+
+// storage types of the tensors a layer only reads (its input and weights):
+// field elements, or signed 8 or 16-bit integers standing for their
+// residues mod p, lifted to F_p by the kernels as they are read
+#define ELEM_U64 0
+#define ELEM_I8 1
+#define ELEM_I16 2
 
 /* for information on these functions, read math.c */
 uint64 myPow(uint64 x, uint64 b);
-uint64 myMod(uint64 x);
 uint64 myModPow(uint64 b, uint64 e);
-void extEuclideanAlg(uint64 u, uint64* u1, uint64* u2, uint64* u3);
-uint64 inv(uint64 a);
-uint64 chi(uint64 v, uint64* r, uint64 n);
-uint64 evaluate_V_i(int mi, int ni, uint64* level_i, uint64* r);
+void batch_inv(const uint64* a, uint64 n, uint64* out);
+
+/*
+ * myMod:
+ *
+ *   efficient modular arithmetic function for p=2^61-1. Only works for this
+ *   value of p.
+ *
+ *   This function might return a number slightly greater than p (possibly by
+ *   an additive factor of 8); It'd be cleaner to check if the answer is
+ *   greater than p and if so subtract p, but I don't want to pay that
+ *   efficiency hit here, so the user should just be aware of this. Use
+ *   myModCanon when the exact representative matters (e.g. comparisons).
+ */
+inline constexpr uint64 myMod(uint64 x)
+{
+    return (x >> 61) + (x & PRIME);
+}
+
+/*
+ * myModCanon:
+ *   reduces x to its canonical representative in [0, p).
+ */
+inline constexpr uint64 myModCanon(uint64 x)
+{
+    x = myMod(x);
+    return x >= PRIME ? x - PRIME : x;
+}
+
+/*
+ * myModReduce:
+ *   folds a 128-bit lazy accumulator down to a 64-bit value congruent to it
+ *   mod p. Like myMod, the result may exceed p by a small additive factor.
+ */
+inline constexpr uint64 myModReduce(uint128 x)
+{
+    uint128 t = (x & PRIME) + (x >> 61);
+    return myMod((uint64)(t & PRIME) + (uint64)(t >> 61));
+}
+
+/*
+ * myModMultLazy:
+ *   multiplies x and y with a single 64x64->128 multiply and one Mersenne
+ *   fold, without the final reduction. For x, y < 2^62 the result is below
+ *   2^64, so it can be summed into a uint128 accumulator and reduced once with
+ *   myModReduce.
+ */
+inline constexpr uint64 myModMultLazy(uint64 x, uint64 y)
+{
+    uint128 z = (uint128)x * y;
+    return ((uint64)z & PRIME) + (uint64)(z >> 61);
+}
 
 //efficient modular multiplication function mod 2^61-1
-inline uint64 myModMult(uint64 x, uint64 y)
+inline constexpr uint64 myModMult(uint64 x, uint64 y)
 {
-    uint64 hi_x = x >> 32;
-    uint64 hi_y = y >> 32;
-    uint64 low_x = x & MASK;
-    uint64 low_y = y & MASK;
+    return myMod(myModMultLazy(x, y));
+}
 
-    //since myMod might return something slightly large than 2^61-1,
-    //we need to multiply by 8 in two pieces to avoid overflow.
-    uint64 piece1 = myMod((hi_x * hi_y)<< 3);
-    uint64 z = (hi_x * low_y + hi_y * low_x);
-    uint64 hi_z = z >> 32;
-    uint64 low_z = z & MASK;
+/*
+ * myLift:
+ *   returns the canonical residue mod p of the signed integer x, |x| < p.
+ */
+inline constexpr uint64 myLift(int64_t x)
+{
+    return (uint64)x + (PRIME & (uint64)(x >> 63));
+}
 
-    //Note 2^64 mod (2^61-1) is 8
-    uint64 piece2 = myMod((hi_z<<3) + myMod((low_z << 32)));
-    uint64 piece3 = myMod(low_x * low_y);
-    uint64 result = myMod(piece1 + piece2 + piece3);
+/*
+ * elem_bytes:
+ *   returns the size of an entry of a tensor of storage type type.
+ */
+inline constexpr size_t elem_bytes(int type)
+{
+    return type == ELEM_I8 ? 1 : type == ELEM_I16 ? 2 : 8;
+}
 
-    return result;
+/*
+ * elem_at:
+ *   returns the address of entry k of the tensor V of storage type type.
+ */
+inline const void* elem_at(const void* V, int type, uint64 k)
+{
+    return (const char*) V + k*elem_bytes(type);
+}
+
+/*
+ * elem_get:
+ *   returns entry k of the tensor V of storage type type as a field element
+ *   (canonical for the narrow types).
+ */
+inline uint64 elem_get(const void* V, int type, uint64 k)
+{
+    if (type == ELEM_I8)
+        return myLift(((const int8_t*) V)[k]);
+    if (type == ELEM_I16)
+        return myLift(((const int16_t*) V)[k]);
+    return ((const uint64*) V)[k];
+}
+
+/*
+ * inv:
+ *    Computes the modular multiplicative inverse of a as a^(p-2) (Fermat),
+ *    using a fixed addition chain for p-2 = 2^61-3 = (2^59-1)*4 + 1: 60
+ *    squarings and 10 multiplications, no divisions and no data-dependent
+ *    branches. Only works for p=2^61-1. Usable in constant expressions, so
+ *    inverses of small constants can be folded at compile time.
+ *
+ * Params:
+ *    uint64 a: the value to which compute the inverse of.
+ *
+ * Returns:
+ *    uint64: the canonical inverse of a, or 0 if a is 0 mod p.
+ */
+inline constexpr uint64 inv(uint64 a)
+{
+    // x^(2^k-1) for the k on the chain 1, 2, 4, 8, 16, 32, 48, 56, 58, 59
+    uint64 t1 = a;
+    uint64 t2 = myModMult(myModMult(t1, t1), t1);
+    uint64 t4 = t2;
+    for (int i = 0; i < 2; i++) t4 = myModMult(t4, t4);
+    t4 = myModMult(t4, t2);
+    uint64 t8 = t4;
+    for (int i = 0; i < 4; i++) t8 = myModMult(t8, t8);
+    t8 = myModMult(t8, t4);
+    uint64 t16 = t8;
+    for (int i = 0; i < 8; i++) t16 = myModMult(t16, t16);
+    t16 = myModMult(t16, t8);
+    uint64 t32 = t16;
+    for (int i = 0; i < 16; i++) t32 = myModMult(t32, t32);
+    t32 = myModMult(t32, t16);
+    uint64 t48 = t32;
+    for (int i = 0; i < 16; i++) t48 = myModMult(t48, t48);
+    t48 = myModMult(t48, t16);
+    uint64 t56 = t48;
+    for (int i = 0; i < 8; i++) t56 = myModMult(t56, t56);
+    t56 = myModMult(t56, t8);
+    uint64 t58 = t56;
+    for (int i = 0; i < 2; i++) t58 = myModMult(t58, t58);
+    t58 = myModMult(t58, t2);
+    uint64 t59 = myModMult(myModMult(t58, t58), t1);
+
+    uint64 result = myModMult(t59, t59);
+    result = myModMult(result, result);
+    return myModCanon(myModMult(result, a));
 }
 
+/*
+ * Fp61:
+ *   value type for elements of F_p, p = 2^61-1. The stored representative v
+ *   is lazy: any value below 2^62 congruent to the element is allowed, so
+ *   arithmetic never pays for a final conditional subtraction. Equality and
+ *   canonical() reduce to [0, p) first.
+ */
+struct Fp61
+{
+    uint64 v;
+
+    Fp61() = default;
+    constexpr Fp61(uint64 x) : v(x) {}
+
+    constexpr uint64 canonical() const { return myModCanon(v); }
+
+    constexpr Fp61 operator+(Fp61 o) const { return Fp61(myMod(v + o.v)); }
+    constexpr Fp61 operator-(Fp61 o) const
+    {
+        return Fp61(myMod(v + 4*PRIME - o.v));
+    }
+    constexpr Fp61 operator*(Fp61 o) const { return Fp61(myModMult(v, o.v)); }
+
+    constexpr bool operator==(Fp61 o) const
+    {
+        return canonical() == o.canonical();
+    }
+    constexpr bool operator!=(Fp61 o) const { return !(*this == o); }
+};
+
+/*
+ * Fp61Acc:
+ *   lazy accumulator for sums of products. Each term is folded once into a
+ *   128-bit sum and the whole sum is reduced a single time by value(), so a
+ *   round of the sum-check pays one reduction instead of one per term.
+ */
+struct Fp61Acc
+{
+    uint128 s;
+
+    constexpr Fp61Acc() : s(0) {}
+
+    void add(uint64 x) { s += x; }
+    void addmul(uint64 x, uint64 y) { s += myModMultLazy(x, y); }
+
+    constexpr Fp61 value() const { return Fp61(myModReduce(s)); }
+};
+
 #endif // MATH_H
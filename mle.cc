@@ -0,0 +1,433 @@
+/*
+ * mle module
+ *
+ * This module contains the evaluation of multilinear extensions of tables
+ * of field elements. The MLE of a table V with 2^mi entries at r is
+ *
+ *   V~(r) = sum_k V[k] * chi_k(r),  chi_k(r) = prod_i eq(k_i, r_i)
+ *
+ * where bit i of k is matched with r[i]. Rather than recomputing chi_k(r)
+ * for every k (mi multiplies each), the index is split into a low half l and
+ * a high half h, chi_k(r) = eq_lo[l] * eq_hi[h], and
+ *
+ *   V~(r) = sum_h eq_hi[h] * (sum_l V[h*2^lo + l] * eq_lo[l])
+ *
+ * which is one lazy multiply per entry plus O(sqrt(2^mi)) table work. The
+ * outer sum is over independent blocks of the table, so it can be split
+ * across workers. Tables a layer only reads may be stored as narrow integers
+ * (see ELEM_I8 in math.h); they are lifted to F_p entry by entry.
+ *
+ * The tables of a layer are matrices padded to powers of two (see struct
+ * layer): only their first rows and the first entries of every row may be
+ * non-zero, and the evaluations of matrices skip the rest.
+ */
+#include "mle.h"
+#include "kernels.h"
+#include "stats.h"
+#include "threadpool.h"
+
+/*
+ * eq_table:
+ *    fills out[k] = chi_k(r) for all k < 2^n, by doubling: binding r[i]
+ *    splits every entry into its x_i = 0 and x_i = 1 halves.
+ *
+ * Params:
+ *    uint64* r: the point, n coordinates
+ *    int n: the number of variables
+ *    uint64* out: receives the 2^n values
+ *
+ * Returns:
+ *    Nothing.
+ */
+void eq_table(uint64* r, int n, uint64* out)
+{
+    stats_count((uint64)1 << n, ((uint64)1 << n)*sizeof(uint64));
+    out[0] = 1;
+    uint64 steps = 1;
+    for (int i = 0; i < n; i++)
+    {
+        uint64 ri = r[i];
+        parallel_for(steps, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int) {
+            for (uint64 k = b; k < e; k++)
+            {
+                uint64 hi = myModMult(out[k], ri);
+                out[k+steps] = hi;
+                out[k] = myMod(out[k] + 2*PRIME - hi);
+            }
+        });
+        steps = steps << 1;
+    }
+}
+
+/* chi:
+ *    computes chi_v(r), where chi is the Lagrange polynomial that takes
+ *    boolean vector v to 1 and all other boolean vectors to 0. (we view v's
+ *    bits as defining a boolean vector). n is dimension of this vector. all
+ *    arithmetic is done mod p.
+ *
+ * Params:
+ *    uint64 v: a boolean vector
+ *    uint64 r: the parameter r to evaluate chi_v with
+ *    uint64 n: the dimension of this vector
+ *
+ * Returns:
+ *    chi_v(r)
+ */
+uint64 chi(uint64 v, uint64* r, uint64 n)
+{
+    uint64 x=v;
+    uint64 c = 1;
+    for(uint64 i = 0; i <n; i++)
+    {
+        if( x&1 )
+            c=myModMult(c, r[i]);
+        else
+            c=myModMult(c, 1+PRIME-r[i]);
+        x=x>>1;
+    }
+    return c;
+}
+
+/*
+ * evaluate_I:
+ *    evaluate the MLE of I at q and random location r in O(logn), i.e.
+ *    eq(q, r) = prod_k (q_k r_k + (1-q_k)(1-r_k)) over d coordinates.
+ *
+ * Params:
+ *    uint64 q: vector q to evaluate the MLE in.
+ *    uint64 r: a pointer to the random location r
+ *    int d: the length up to which the MLE will be evaluated at.
+ *
+ * Returns:
+ *    uint64: the result of the computation.
+ */
+uint64 evaluate_I(uint64* q, uint64* r, int d)
+{
+    uint64 ans=1;
+    for(uint64 k = 0; k < d; k++)
+        ans = myModMult(ans,
+                myMod(myModMult(q[k],r[k]) +
+                      myModMult(1+PRIME-q[k], 1+PRIME-r[k])) );
+    return ans;
+}
+
+/*
+ * mle_blocks:
+ *    accumulates sum_h eq_hi[h] * (sum_l V[h*lo_size + l] * eq_lo[l]) over
+ *    the high indices h in [hbegin, hend) into acc, for a table level of
+ *    storage type type, made of rows of row_len entries (a multiple of
+ *    lo_size). Entries at or past ni, and past the first cols of their row,
+ *    are zero and skipped.
+ */
+static void mle_blocks(const void* level, int type, uint64 ni, uint64 row_len,
+        uint64 cols, uint64* eq_lo, uint64 lo_size, uint64* eq_hi,
+        uint64 hbegin, uint64 hend, Fp61Acc& acc)
+{
+    const uint64* V = (const uint64*) level;
+    const int8_t* V8 = (const int8_t*) level;
+    const int16_t* V16 = (const int16_t*) level;
+    for (uint64 h = hbegin; h < hend; h++)
+    {
+        uint64 base = h*lo_size;
+        if (base >= ni)
+            break;
+        uint64 col = base & (row_len - 1);
+        if (col >= cols)
+            continue;
+        uint64 len = (ni - base < lo_size) ? ni - base : lo_size;
+        if (cols - col < len)
+            len = cols - col;
+
+        Fp61Acc block;
+        if (type == ELEM_I8)
+            for (uint64 l = 0; l < len; l++)
+                block.addmul(myLift(V8[base + l]), eq_lo[l]);
+        else if (type == ELEM_I16)
+            for (uint64 l = 0; l < len; l++)
+                block.addmul(myLift(V16[base + l]), eq_lo[l]);
+        else
+            for (uint64 l = 0; l < len; l++)
+                block.addmul(V[base + l], eq_lo[l]);
+        acc.addmul(block.value().v, eq_hi[h]);
+    }
+}
+
+/*
+ * bind_rows_bytes:
+ *    returns the arena footprint of bind_rows on row_vars row variables.
+ */
+size_t bind_rows_bytes(int row_vars)
+{
+    return arena_words_bytes((uint64)1 << row_vars);
+}
+
+// columns of the output accumulated together in bind_rows
+#define BIND_BLOCK 1024
+// bytes of the matrix bind_rows reads per chunk of rows
+#define BIND_CHUNK (16 << 20)
+
+/*
+ * bind_rows:
+ *    binds all the row variables of a row-major matrix M (2^row_vars rows of
+ *    n entries, of which only the first rows rows and the first cols
+ *    columns may be non-zero) to point at once:
+ *
+ *      out[k] = sum_i chi_i(point) * M[i*n+k]
+ *
+ *    This is what folding the high-order variables one at a time yields,
+ *    but done as a single streaming pass over M against an eq table
+ *    instead of row_vars passes over a halving array. Bit b of the row
+ *    index is matched with point[b]. M is only read, at its own width: this
+ *    is where narrow entries become field elements.
+ *
+ * Params:
+ *    const void* M: the matrix
+ *    int type: the storage type of M
+ *    int row_vars: the number of row variables
+ *    uint64 rows: the number of rows read
+ *    uint64 n: the length of a row
+ *    uint64 cols: the number of columns read; out is zero past them
+ *    uint64* point: row_vars coordinates
+ *    uint64* out: receives the n bound entries
+ *    arena* scratch: arena the eq table is allocated from (see
+ *                    bind_rows_bytes)
+ *
+ * Returns:
+ *    Nothing.
+ */
+void bind_rows(const void* M, int type, int row_vars, uint64 rows, uint64 n,
+        uint64 cols, uint64* point, uint64* out, arena* scratch)
+{
+    size_t mark = arena_mark(scratch);
+    uint64* eq = arena_words(scratch, (uint64)1 << row_vars);
+    eq_table(point, row_vars, eq);
+    for (uint64 k = cols; k < n; k++)
+        out[k] = 0;
+    stats_count(rows*cols, rows*cols*elem_bytes(type) + n*sizeof(uint64));
+
+    // M is consumed in chunks of consecutive rows, every column block
+    // sweeping the rows of a chunk, so each entry is read exactly once and M
+    // is streamed front to back: a matrix mapped from disk is never needed
+    // in memory as a whole
+    uint64 chunk = BIND_CHUNK/(n*elem_bytes(type)) + 1;
+    for (uint64 k = 0; k < cols; k++)
+        out[k] = 0;
+    for (uint64 i0 = 0; i0 < rows; i0 += chunk)
+    {
+        uint64 i1 = (rows - i0 < chunk) ? rows : i0 + chunk;
+        parallel_for(cols, BIND_BLOCK, [&](uint64 b, uint64 e, int) {
+            for (uint64 k0 = b; k0 < e; k0 += BIND_BLOCK)
+            {
+                uint64 len = (e - k0 < BIND_BLOCK) ? e - k0 : BIND_BLOCK;
+                for (uint64 i = i0; i < i1; i++)
+                    scale_add_lift_kernel(out + k0,
+                            elem_at(M, type, i*n + k0), type, eq[i], len);
+            }
+        });
+    }
+
+    arena_release(scratch, mark);
+}
+
+/*
+ * mle_multi:
+ *    evaluate_V_i_multi on tables of rows of row_len entries, of which only
+ *    the first cols may be non-zero, splitting the index into lo low-order
+ *    bits (lo_size must divide row_len) and the rest.
+ */
+static void mle_multi(int mi, int lo, uint64 ni, uint64 row_len, uint64 cols,
+        const void** levels, int type, uint64** points, int count,
+        uint64* out, arena* scratch)
+{
+    int hi = mi - lo;
+    uint64 lo_size = (uint64)1 << lo;
+    uint64 hi_size = (uint64)1 << hi;
+    uint64 live = (ni + row_len - 1)/row_len*cols;
+    if (live > ni)
+        live = ni;
+    stats_count(count*live, count*live*elem_bytes(type));
+
+    size_t mark = arena_mark(scratch);
+    uint64* tables = arena_words(scratch, count*(lo_size+hi_size));
+    int nthreads = threadpool_size();
+    Fp61Acc* acc = (Fp61Acc*) arena_alloc(scratch,
+            count*nthreads*sizeof(Fp61Acc));
+    for (int k = 0; k < count*nthreads; k++)
+        acc[k] = Fp61Acc();
+    for (int c = 0; c < count; c++)
+    {
+        uint64* eq_lo = tables + c*(lo_size+hi_size);
+        eq_table(points[c], lo, eq_lo);
+        eq_table(points[c] + lo, hi, eq_lo + lo_size);
+    }
+
+    // blocks of 2^lo entries, visited once for all pairs; every thread
+    // accumulates into its own row of acc
+    uint64 grain = PARALLEL_GRAIN/lo_size + 1;
+    parallel_for(hi_size, grain, [&](uint64 b, uint64 e, int id) {
+        for (uint64 h = b; h < e; h++)
+        {
+            for (int c = 0; c < count; c++)
+            {
+                uint64* eq_lo = tables + c*(lo_size+hi_size);
+                mle_blocks(levels[c], type, ni, row_len, cols, eq_lo,
+                        lo_size, eq_lo + lo_size, h, h+1, acc[id*count+c]);
+            }
+        }
+    });
+
+    for (int c = 0; c < count; c++)
+    {
+        Fp61Acc total;
+        for (int t = 0; t < nthreads; t++)
+            total.add(acc[t*count+c].value().v);
+        out[c] = total.value().canonical();
+    }
+
+    arena_release(scratch, mark);
+}
+
+/*
+ * mle_split:
+ *    returns the number of low-order bits mle_multi splits the index of a
+ *    matrix of row_vars row and col_vars column variables into.
+ */
+static int mle_split(int row_vars, int col_vars)
+{
+    int mi = row_vars + col_vars;
+    return (mi/2 < col_vars) ? mi/2 : col_vars;
+}
+
+/*
+ * mle_scratch_bytes:
+ *    returns the arena footprint of evaluate_matrix_multi and
+ *    evaluate_matrix_batch on count matrices of row_vars row and col_vars
+ *    column variables; evaluate_V_i_multi on mi variables is that of a
+ *    matrix of 0 row and mi column variables.
+ */
+size_t mle_scratch_bytes(int row_vars, int col_vars, int count)
+{
+    int lo = mle_split(row_vars, col_vars);
+    int hi = row_vars + col_vars - lo;
+    return arena_words_bytes(count*(((uint64)1 << lo) + ((uint64)1 << hi))) +
+           arena_bytes(count*threadpool_size()*sizeof(Fp61Acc)) +
+           arena_bytes(count*sizeof(const void*)) +
+           arena_bytes(count*sizeof(uint64*));
+}
+
+/*
+ * evaluate_V_i_multi:
+ *    evaluates count MLEs in one pass over the index space: out[c] is the
+ *    MLE of levels[c] at points[c]. Pairs may share a table (several points)
+ *    or a point (several tables); both are read once per block while the
+ *    block is in cache.
+ *
+ * Params:
+ *    int mi: the number of variables of every table
+ *    uint64 ni: the number of (possibly) non-zero entries of every table
+ *    const void** levels: the count tables
+ *    int type: the storage type of the tables
+ *    uint64** points: the count points, mi coordinates each
+ *    int count: the number of (table, point) pairs
+ *    uint64* out: receives the count evaluations
+ *    arena* scratch: arena the eq tables are allocated from (see
+ *                    mle_scratch_bytes)
+ *
+ * Returns:
+ *    Nothing.
+ */
+void evaluate_V_i_multi(int mi, uint64 ni, const void** levels, int type,
+        uint64** points, int count, uint64* out, arena* scratch)
+{
+    uint64 size = (uint64)1 << mi;
+    mle_multi(mi, mi/2, ni, size, size, levels, type, points, count, out,
+            scratch);
+}
+
+/*
+ * evaluate_matrix_multi:
+ *    evaluate_V_i_multi on row-major matrices of 2^row_vars rows of
+ *    2^col_vars entries, of which only the first rows rows and the first
+ *    cols columns may be non-zero; the rest is not read. The column
+ *    variables are the low-order ones.
+ *
+ * Params:
+ *    int row_vars, col_vars: the numbers of row and column variables
+ *    uint64 rows, cols: the numbers of rows and columns read
+ *    const void** levels, int type, uint64** points, int count,
+ *    uint64* out, arena* scratch: as for evaluate_V_i_multi
+ *
+ * Returns:
+ *    Nothing.
+ */
+void evaluate_matrix_multi(int row_vars, int col_vars, uint64 rows,
+        uint64 cols, const void** levels, int type, uint64** points,
+        int count, uint64* out, arena* scratch)
+{
+    mle_multi(row_vars + col_vars, mle_split(row_vars, col_vars),
+            rows << col_vars, (uint64)1 << col_vars, cols, levels, type,
+            points, count, out, scratch);
+}
+
+/*
+ * evaluate_V_i:
+ *    evaluates V_i polynomial at location r. Here V_i is described in GKR08;
+ *    it is the multi-linear extension] of the vector of gate values at level i
+ *    of the circuit
+ *
+ * Params:
+ *    int mi: the dimensionality of k
+ *    int ni: the number of vectors
+ *    uint64* level_i: the contents of the vectors for this level
+ *    uint64* r: the value of r to evaluate V_i(r) of.
+ *    arena* scratch: arena the tables are allocated from (see
+ *                    mle_scratch_bytes)
+ *
+ */
+uint64 evaluate_V_i(int mi, int ni, uint64* level_i, uint64* r,
+        arena* scratch)
+{
+    uint64 ans;
+    const void* level = level_i;
+    evaluate_V_i_multi(mi, ni, &level, ELEM_U64, &r, 1, &ans, scratch);
+    return ans;
+}
+
+/*
+ * evaluate_matrix_batch:
+ *    evaluates the MLEs of count matrices laid out one after another in V at
+ *    the same point r, in one pass. Every matrix has 2^row_vars rows of
+ *    2^col_vars entries, of which only the first cols may be non-zero.
+ *
+ * Params:
+ *    int row_vars, col_vars: the numbers of row and column variables
+ *    uint64 cols: the number of columns read
+ *    const void* V: the matrices
+ *    int type: the storage type of the matrices
+ *    int count: the number of matrices
+ *    uint64* r: the point, col_vars + row_vars coordinates
+ *    uint64* out: receives the count evaluations
+ *    arena* scratch: arena the eq tables are allocated from (see
+ *                    mle_scratch_bytes)
+ *
+ * Returns:
+ *    Nothing.
+ */
+void evaluate_matrix_batch(int row_vars, int col_vars, uint64 cols,
+        const void* V, int type, int count, uint64* r, uint64* out,
+        arena* scratch)
+{
+    uint64 rows = (uint64)1 << row_vars;
+    size_t mark = arena_mark(scratch);
+    const void** levels = (const void**) arena_alloc(scratch,
+            count*sizeof(const void*));
+    uint64** points = (uint64**) arena_alloc(scratch, count*sizeof(uint64*));
+    for (int c = 0; c < count; c++)
+    {
+        levels[c] = elem_at(V, type, (c*rows) << col_vars);
+        points[c] = r;
+    }
+    evaluate_matrix_multi(row_vars, col_vars, rows, cols, levels, type,
+            points, count, out, scratch);
+    arena_release(scratch, mark);
+}
@@ -0,0 +1,35 @@
+/*
+ * mle module header file
+ *
+ * This module contains the evaluation of multilinear extensions (MLEs) of
+ * tables of field elements, which both the prover and the verifier use to
+ * turn a table into a claim about a single point.
+ */
+#ifndef MLE_H
+#define MLE_H
+
+#include <cstddef>
+
+#include "arena.h"
+#include "math.h"
+
+/* for information on these functions, read mle.cc */
+void eq_table(uint64* r, int n, uint64* out);
+uint64 chi(uint64 v, uint64* r, uint64 n);
+uint64 evaluate_I(uint64* q, uint64* r, int d);
+uint64 evaluate_V_i(int mi, int ni, uint64* level_i, uint64* r,
+        arena* scratch);
+size_t bind_rows_bytes(int row_vars);
+void bind_rows(const void* M, int type, int row_vars, uint64 rows, uint64 n,
+        uint64 cols, uint64* point, uint64* out, arena* scratch);
+size_t mle_scratch_bytes(int row_vars, int col_vars, int count);
+void evaluate_V_i_multi(int mi, uint64 ni, const void** levels, int type,
+        uint64** points, int count, uint64* out, arena* scratch);
+void evaluate_matrix_multi(int row_vars, int col_vars, uint64 rows,
+        uint64 cols, const void** levels, int type, uint64** points,
+        int count, uint64* out, arena* scratch);
+void evaluate_matrix_batch(int row_vars, int col_vars, uint64 cols,
+        const void* V, int type, int count, uint64* r, uint64* out,
+        arena* scratch);
+
+#endif // MLE_H
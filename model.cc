@@ -0,0 +1,456 @@
+/*
+ * model module
+ *
+ * This module builds the network being proven from its architecture. The
+ * input and the parameters are pseudo-random values below 100, drawn from a
+ * fixed seed, or are loaded from a model file (see model.h). Generated
+ * inputs and weights are stored as 8-bit integers.
+ */
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "conv.h"
+#include "model.h"
+#include "sha256.h"
+
+using namespace std;
+
+/*
+ * model_rand:
+ *    splitmix64 step; returns the next pseudo-random word of state.
+ */
+uint64 model_rand(uint64* state)
+{
+    uint64 z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * weight_vars:
+ *    returns the number of column variables of the weights of the layer of
+ *    shape a: d, or the variables of the kernel index of a convolutional
+ *    layer. The weights have one row per output (per output channel).
+ */
+static int weight_vars(const int* a)
+{
+    return a[5] ? conv_weight_vars(a[1], a[5], a[6], a[7]) : a[1];
+}
+
+/*
+ * tensor_words:
+ *    returns the number of entries of tensor t of a model file: t = 0 is the
+ *    input, t = 1 + 2i and t = 2 + 2i the weights and bias of layer i.
+ */
+static uint64 tensor_words(vector<int*>& arch, int batches, int t)
+{
+    if (t == 0)
+        return batches*myPow(2, arch[0][0] + arch[0][1]);
+    int* a = arch[(t-1)/2];
+    int rows = a[5] ? a[2] - a[6] - a[7] : a[2];
+    return (t % 2) ? myPow(2, rows + weight_vars(a)) : myPow(2, a[2]);
+}
+
+/*
+ * model_open:
+ *    maps the model file at path and checks that it holds a network of
+ *    architecture arch run on batches batches.
+ *
+ * Params:
+ *    model_file* mf: the mapped file
+ *    const char* path: the model file
+ *    vector<int*>& arch: the architecture
+ *    int batches: the number of batches
+ *
+ * Returns:
+ *    bool: false if the file cannot be mapped, is not about this network or
+ *          holds a U64 entry that is not canonical; nothing is left mapped.
+ */
+bool model_open(model_file* mf, const char* path, vector<int*>& arch,
+        int batches)
+{
+    int L = arch.size();
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return cout << "Cannot open the model file " << path << endl, false;
+    }
+    mf->size = st.st_size;
+    if (mf->size < MODEL_HEADER_WORDS(L)*sizeof(uint64))
+        return close(fd), cout << "Malformed model file " << path << endl,
+               false;
+
+    // the pages are shared with every other process mapping the model
+    void* base = mmap(NULL, mf->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return cout << "Cannot map the model file " << path << endl, false;
+    mf->base = (const char*) base;
+    mf->header = (const uint64*) base;
+
+    const uint64* h = mf->header;
+    bool match = h[0] == MODEL_MAGIC && h[1] == L && h[2] == batches;
+    for (int i = 0; match && i < L; i++)
+        for (int k = 0; k < LAYER_SHAPE_WORDS; k++)
+            match = match && h[3 + LAYER_SHAPE_WORDS*i + k] == arch[i][k];
+    if (!match)
+        return model_close(mf),
+               cout << "The model file is not about this network" << endl,
+               false;
+
+    for (int t = 0; t < 1 + 2*L; t++)
+    {
+        uint64 dtype = h[3 + LAYER_SHAPE_WORDS*L + 2*t];
+        uint64 offset = h[4 + LAYER_SHAPE_WORDS*L + 2*t];
+        uint64 n = tensor_words(arch, batches, t);
+        uint64 bytes = n*elem_bytes(dtype);
+        if (dtype > MODEL_I16 || offset % MODEL_ALIGN != 0 ||
+            offset < MODEL_HEADER_WORDS(L)*sizeof(uint64) ||
+            offset > mf->size || bytes > mf->size - offset)
+            return model_close(mf),
+                   cout << "Malformed model file " << path << endl, false;
+
+        // U64 payloads are used in place, so every entry must already be
+        // canonical (this reads them all, once)
+        if (dtype == MODEL_U64)
+            for (uint64 k = 0; k < n; k++)
+                if (((const uint64*) (mf->base + offset))[k] >= PRIME)
+                    return model_close(mf),
+                           cout << "Malformed model file " << path << endl,
+                           false;
+
+        // the kernels skip the padding of the input and the weights, but a
+        // bias is added to every entry of a row
+        if (t != 0 && t % 2 == 0)
+            for (uint64 k = arch[(t-1)/2][4]; k < n; k++)
+                if (elem_get(mf->base + offset, dtype, k) != 0)
+                    return model_close(mf),
+                           cout << "Malformed model file " << path << endl,
+                           false;
+    }
+    return true;
+}
+
+/*
+ * model_close:
+ *    unmaps a model file.
+ */
+void model_close(model_file* mf)
+{
+    munmap((void*) mf->base, mf->size);
+}
+
+/*
+ * layer_shape:
+ *    fills in the LAYER_SHAPE_WORDS words describing the shape of layer l in
+ *    the header of a file, in the order of the architecture (see
+ *    read_architecture_from_file).
+ */
+void layer_shape(const layer* l, uint64* words)
+{
+    words[0] = l->e;
+    words[1] = l->d;
+    words[2] = l->f;
+    words[3] = l->n_true;
+    words[4] = l->p_true;
+    words[5] = l->k;
+    words[6] = l->h;
+    words[7] = l->w;
+}
+
+/*
+ * model_save:
+ *    writes the input, weights and biases of net to a model file at path,
+ *    every payload of type dtype.
+ *
+ * Returns:
+ *    Nothing. Exits if the file cannot be written or an entry does not fit
+ *    dtype.
+ */
+void model_save(const char* path, vector<layer>& net, int batches, int dtype)
+{
+    int L = net.size();
+    vector<uint64> header(MODEL_HEADER_WORDS(L));
+    header[0] = MODEL_MAGIC;
+    header[1] = L;
+    header[2] = batches;
+    vector<int> shapes(LAYER_SHAPE_WORDS*L);
+    vector<int*> arch(L);
+    for (int i = 0; i < L; i++)
+    {
+        uint64* shape = &header[3 + LAYER_SHAPE_WORDS*i];
+        layer_shape(&net[i], shape);
+        arch[i] = &shapes[LAYER_SHAPE_WORDS*i];
+        for (int k = 0; k < LAYER_SHAPE_WORDS; k++)
+            arch[i][k] = shape[k];
+    }
+    uint64 offset = header.size()*sizeof(uint64);
+    for (int t = 0; t < 1 + 2*L; t++)
+    {
+        offset = (offset + MODEL_ALIGN-1) / MODEL_ALIGN * MODEL_ALIGN;
+        header[3 + LAYER_SHAPE_WORDS*L + 2*t] = dtype;
+        header[4 + LAYER_SHAPE_WORDS*L + 2*t] = offset;
+        offset += tensor_words(arch, batches, t)*elem_bytes(dtype);
+    }
+
+    int64_t limit = dtype == MODEL_I8 ? INT8_MAX :
+                    dtype == MODEL_I16 ? INT16_MAX : 0;
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        cout << "Cannot write the model file " << path << endl, exit(1);
+    bool ok = fwrite(header.data(), sizeof(uint64), header.size(), file) ==
+              header.size();
+    for (int t = 0; ok && t < 1 + 2*L; t++)
+    {
+        const layer* l = &net[(t-1)/2];
+        const void* V = (t == 0) ? net[0].X : (t % 2) ? l->W : l->b;
+        int type = (t == 0) ? net[0].Xtype : (t % 2) ? l->Wtype : ELEM_U64;
+        uint64 n = tensor_words(arch, batches, t);
+        ok = fseek(file, header[4 + LAYER_SHAPE_WORDS*L + 2*t], SEEK_SET) == 0;
+        for (uint64 k = 0; ok && k < n; k++)
+        {
+            uint64 v = myModCanon(elem_get(V, type, k));
+            if (dtype == MODEL_U64)
+            {
+                ok = fwrite(&v, sizeof(v), 1, file) == 1;
+                continue;
+            }
+            // small entries are stored as the signed integer of least
+            // magnitude with the same residue
+            int64_t x = (v <= (uint64) limit) ? (int64_t) v :
+                        -(int64_t) (PRIME - v);
+            if (x < -limit-1 || x > limit)
+                cout << "The model does not fit " << 8*elem_bytes(dtype)
+                     << "-bit entries" << endl, exit(1);
+            int8_t x8 = x;
+            int16_t x16 = x;
+            ok = (dtype == MODEL_I8) ? fwrite(&x8, 1, 1, file) == 1 :
+                                       fwrite(&x16, 2, 1, file) == 1;
+        }
+    }
+    if (fclose(file) != 0 || !ok)
+        cout << "Cannot write the model file " << path << endl, exit(1);
+}
+
+/*
+ * model_digest:
+ *    hashes the input, weights and biases of net, run on batches batches,
+ *    into the MODEL_DIGEST_WORDS words of digest: the SHA-256 of the
+ *    canonical entries of every tensor, in the order of a model file, so
+ *    that the digest does not depend on how the tensors are stored.
+ */
+void model_digest(vector<layer>& net, int batches, uint64* digest)
+{
+    int L = net.size();
+    vector<int> shapes(LAYER_SHAPE_WORDS*L);
+    vector<int*> arch(L);
+    for (int i = 0; i < L; i++)
+    {
+        uint64 shape[LAYER_SHAPE_WORDS];
+        layer_shape(&net[i], shape);
+        arch[i] = &shapes[LAYER_SHAPE_WORDS*i];
+        for (int k = 0; k < LAYER_SHAPE_WORDS; k++)
+            arch[i][k] = shape[k];
+    }
+
+    sha256_ctx ctx;
+    sha256_init(&ctx);
+    uint64 words[1024];
+    for (int t = 0; t < 1 + 2*L; t++)
+    {
+        const layer* l = &net[(t-1)/2];
+        const void* V = (t == 0) ? net[0].X : (t % 2) ? l->W : l->b;
+        int type = (t == 0) ? net[0].Xtype : (t % 2) ? l->Wtype : ELEM_U64;
+        uint64 n = tensor_words(arch, batches, t);
+        for (uint64 k0 = 0; k0 < n; k0 += 1024)
+        {
+            uint64 len = (n - k0 < 1024) ? n - k0 : 1024;
+            for (uint64 k = 0; k < len; k++)
+                words[k] = myModCanon(elem_get(V, type, k0 + k));
+            sha256_update(&ctx, words, len*sizeof(uint64));
+        }
+    }
+    unsigned char hash[SHA256_DIGEST_BYTES];
+    sha256_final(&ctx, hash);
+    memcpy(digest, hash, sizeof(hash));
+}
+
+/*
+ * model_type:
+ *    returns the payload type of tensor t of a model file.
+ */
+static int model_type(const model_file* mf, int t)
+{
+    return mf->header[3 + LAYER_SHAPE_WORDS*mf->header[1] + 2*t];
+}
+
+/*
+ * model_payload:
+ *    returns the payload of tensor t of a model file, in place.
+ */
+static const void* model_payload(const model_file* mf, int t)
+{
+    return mf->base + mf->header[4 + LAYER_SHAPE_WORDS*mf->header[1] + 2*t];
+}
+
+/*
+ * model_bias:
+ *    returns the bias, tensor t of a model file, as n field elements: the
+ *    payload itself if it holds field elements, otherwise a copy widened
+ *    into mem.
+ */
+static uint64* model_bias(const model_file* mf, int t, uint64 n, arena* mem)
+{
+    int type = model_type(mf, t);
+    if (type == MODEL_U64)
+        return (uint64*) model_payload(mf, t);
+
+    uint64* b = arena_words(mem, n);
+    for (uint64 k = 0; k < n; k++)
+        b[k] = elem_get(model_payload(mf, t), type, k);
+    return b;
+}
+
+/*
+ * model_bytes:
+ *    returns the arena footprint of model_init with the same arguments. The
+ *    tensors of a model file mf take no arena space, but for narrow biases.
+ */
+size_t model_bytes(vector<int*>& arch, int batches, bool activations,
+        const model_file* mf)
+{
+    int L = arch.size();
+    size_t bytes = 0;
+    for (int t = 0; t < 1 + 2*L; t++)
+    {
+        uint64 n = tensor_words(arch, batches, t);
+        if (!mf)
+            bytes += (t == 0 || t % 2) ? arena_bytes(n) : arena_words_bytes(n);
+        else if (t != 0 && t % 2 == 0 && model_type(mf, t) != MODEL_U64)
+            bytes += arena_words_bytes(n);
+    }
+    for (int i = 0; i < L; i++)
+    {
+        uint64 m = myPow(2, arch[i][0]);
+        uint64 n = myPow(2, arch[i][1]);
+        uint64 p = myPow(2, arch[i][2]);
+        if (i != 0 && activations)
+            bytes += arena_words_bytes(batches*m*n);
+        if (activations)
+            bytes += arena_words_bytes(batches*m*p);
+    }
+    return bytes;
+}
+
+/*
+ * model_init:
+ *    builds the layers of the network described by arch (the shape of every
+ *    layer, see read_architecture_from_file) and its input, generated or
+ *    taken from the model file mf.
+ *
+ * Params:
+ *    vector<layer>& net: receives the layers
+ *    vector<int*>& arch: the architecture
+ *    int batches: the number of batches the network is run on
+ *    bool activations: whether to allocate the tensors of the forward pass
+ *                      (Y of every layer, X of every layer but the first)
+ *    const model_file* mf: the model file (see model_open), or NULL to
+ *                          generate the network
+ *    arena* mem: the arena the tensors are allocated from
+ *
+ * Returns:
+ *    Nothing.
+ */
+void model_init(vector<layer>& net, vector<int*>& arch, int batches,
+        bool activations, const model_file* mf, arena* mem)
+{
+    uint64 state = MODEL_SEED;
+    int L = arch.size();
+    net.resize(L);
+    for (int i = 0; i < L; i++)
+    {
+        layer* l = &net[i];
+        l->e = arch[i][0];
+        l->d = arch[i][1];
+        l->f = arch[i][2];
+        l->n_true = arch[i][3];
+        l->p_true = arch[i][4];
+        l->k = arch[i][5];
+        l->h = arch[i][6];
+        l->w = arch[i][7];
+        uint64 m = myPow(2, l->e);
+        uint64 n = myPow(2, l->d);
+        uint64 p = myPow(2, l->f);
+
+        l->X = (i != 0 && activations) ? arena_words(mem, batches*m*n) : NULL;
+        l->Xtype = ELEM_U64;
+        l->Y = activations ? arena_words(mem, batches*m*p) : NULL;
+        if (mf)
+        {
+            if (i == 0)
+            {
+                l->X = (void*) model_payload(mf, 0);
+                l->Xtype = model_type(mf, 0);
+            }
+            l->W = model_payload(mf, 1 + 2*i);
+            l->Wtype = model_type(mf, 1 + 2*i);
+            l->b = model_bias(mf, 2 + 2*i, p, mem);
+            continue;
+        }
+
+        uint64 weights = tensor_words(arch, batches, 1 + 2*i);
+        int8_t* W = (int8_t*) arena_alloc(mem, weights);
+        l->W = W;
+        l->Wtype = ELEM_I8;
+        l->b = arena_words(mem, p);
+
+        // only the true sizes are drawn, the padding is zero
+        if (i == 0)
+        {
+            int8_t* X = (int8_t*) arena_alloc(mem, batches*m*n);
+            for (uint64 k = 0; k < batches*m*n; k++)
+                X[k] = (k % n < l->n_true) ? model_rand(&state) % 100 : 0;
+            l->X = X;
+            l->Xtype = ELEM_I8;
+        }
+        if (l->k)
+        {
+            // a kernel of k x k per (output, input) channel pair, and a
+            // bias per output channel
+            uint64 hw = myPow(2, l->h + l->w);
+            uint64 K = myPow(2, conv_kernel_vars(l->k));
+            uint64 nw = myPow(2, weight_vars(arch[i]));
+            for (uint64 t = 0; t < weights; t++)
+            {
+                uint64 o = t / nw, c = t % nw / (K*K);
+                uint64 ki = t % (K*K) / K, kj = t % K;
+                W[t] = (o < l->p_true/hw && c < l->n_true/hw &&
+                        ki < (uint64) l->k && kj < (uint64) l->k) ?
+                       model_rand(&state) % 100 : 0;
+            }
+            for (uint64 o = 0; o < p/hw; o++)
+            {
+                uint64 bias = (o < l->p_true/hw) ?
+                              model_rand(&state) % 100 : 0;
+                for (uint64 t = 0; t < hw; t++)
+                    l->b[o*hw + t] = bias;
+            }
+            continue;
+        }
+        for (uint64 k = 0; k < p*n; k++)
+            W[k] = (k / n < l->p_true && k % n < l->n_true) ?
+                   model_rand(&state) % 100 : 0;
+        for (uint64 k = 0; k < p; k++)
+            l->b[k] = (k < l->p_true) ? model_rand(&state) % 100 : 0;
+    }
+}
@@ -0,0 +1,109 @@
+/*
+ * model module header file
+ *
+ * This module contains the tensors of the network being proven: its input,
+ * the weights and bias of every layer and, on the prover's side, the
+ * activations of the forward pass.
+ *
+ * The input and the parameters are either generated from a fixed seed or
+ * loaded from a model file, which is mapped into memory: a header of 64-bit
+ * words followed by the raw payload of every tensor, each starting on a page
+ * boundary,
+ *
+ *   MODEL_MAGIC, L, batches, the shape of every layer (see layer_shape),
+ *   (dtype, byte offset) of X (the input), then of W and b of every layer
+ *
+ * A payload is the tensor in the layout of struct layer, one entry per
+ * element: a canonical field element (MODEL_U64), or a signed 8 or 16-bit
+ * integer (MODEL_I8, MODEL_I16) standing for its residue mod p. The input
+ * and the weights are used in place, whatever their type, so that the pages
+ * of a model are only read when they are used and are shared by every
+ * process that maps it; narrow biases are widened when loaded.
+ */
+#ifndef MODEL_H
+#define MODEL_H
+
+#include <vector>
+
+#include "arena.h"
+#include "math.h"
+
+// the network and its input are generated from this seed, so that the
+// prover and a standalone verifier agree on them
+#define MODEL_SEED 1
+
+#define MODEL_MAGIC 0x534e4d4f44454c31ULL  // "SNMODEL1"
+
+// payload types of the tensors of a model file, the storage types of math.h
+#define MODEL_U64 ELEM_U64
+#define MODEL_I8 ELEM_I8
+#define MODEL_I16 ELEM_I16
+
+// alignment of the payloads of a model file, one page
+#define MODEL_ALIGN 4096
+
+// number of words of the shape of a layer in the headers of model, proof and
+// cache files: e, d, f, the true sizes of its input and output, and k, h, w
+#define LAYER_SHAPE_WORDS 8
+
+// number of words of the header of a model file of L layers
+#define MODEL_HEADER_WORDS(L) (3 + LAYER_SHAPE_WORDS*(L) + 2*(1 + 2*(L)))
+
+// number of words of the digest of the input and parameters of a network
+// (see model_digest), one SHA-256 hash
+#define MODEL_DIGEST_WORDS 4
+
+// the tensors of a fully connected layer, kept from the forward pass for the
+// proof. X is its input (batches tables of m x n), W its weights (p x n,
+// one row of n per output neuron), b its bias (p) and Y = X W^T its output
+// before the bias (batches tables of m x p); m = 2^e, n = 2^d, p = 2^f. The
+// verifier only holds the input of the first layer, the weights and biases.
+// X and W are only read by the proof and may be stored as narrow integers
+// (Xtype, Wtype, see ELEM_I8 in math.h); the input of a hidden layer, written
+// by the forward pass, holds field elements.
+//
+// n_true and p_true are the true numbers of inputs and outputs, before n and
+// p are rounded up to powers of two. The columns of X and W past n_true, the
+// rows of W and the entries of b past p_true, and so the columns of Y past
+// p_true, are zero: the kernels skip them. The rows of X past the true batch
+// size are not, as the bias is added to every row.
+//
+// A convolutional layer (see conv.h) has a kernel size k > 0 (k = 0 for a
+// fully connected layer). Its input and output are maps of 2^h x 2^w pixels,
+// 2^(d-h-w) and 2^(f-h-w) channels, laid out channel by channel in a row; W
+// holds one row per output channel over the index (c, i, j) of the kernel
+// (see conv_weight_vars), and b, of p entries, repeats the bias of every
+// channel over its pixels.
+struct layer {
+    int e, d, f;
+    uint64 n_true, p_true;
+    int k, h, w;
+    void* X;
+    const void* W;
+    uint64* b;
+    uint64* Y;
+    int Xtype, Wtype;
+};
+
+// a model file mapped into memory
+struct model_file {
+    const char* base;
+    size_t size;
+    const uint64* header;
+};
+
+/* for information on these functions, read model.cc */
+uint64 model_rand(uint64* state);
+bool model_open(model_file* mf, const char* path, std::vector<int*>& arch,
+        int batches);
+void model_close(model_file* mf);
+void model_digest(std::vector<layer>& net, int batches, uint64* digest);
+void layer_shape(const layer* l, uint64* words);
+void model_save(const char* path, std::vector<layer>& net, int batches,
+        int dtype);
+size_t model_bytes(std::vector<int*>& arch, int batches, bool activations,
+        const model_file* mf);
+void model_init(std::vector<layer>& net, std::vector<int*>& arch, int batches,
+        bool activations, const model_file* mf, arena* mem);
+
+#endif // MODEL_H
@@ -0,0 +1,112 @@
+/*
+ * poly module
+ *
+ * This module contains the interpolation of the round polynomials exchanged
+ * in the sum-check protocol. A round polynomial of degree n-1 is sent as its
+ * evaluations at 0, 1, ..., n-1 and extrapolated to the verifier's challenge
+ * in barycentric form:
+ *
+ *   g(r) = sum_i vec[i] * w_i * prod_{j != i} (r - j),
+ *   w_i  = 1 / prod_{j != i} (i - j)
+ *
+ * The weights only depend on n. The protocol only uses n = 3 (degree 2,
+ * matrix multiplication and bias) and n = 4 (degree 3, square activation),
+ * whose weights are folded at compile time; other sizes get them from one
+ * batch inversion.
+ */
+#include "poly.h"
+
+// largest n whose scratch is kept on the stack in extrap
+#define EXTRAP_STACK 16
+
+static constexpr uint64 weights_3[3] = {
+    inv(2), PRIME - 1, inv(2)
+};
+
+static constexpr uint64 weights_4[4] = {
+    PRIME - inv(6), inv(2), PRIME - inv(2), inv(6)
+};
+
+/*
+ * lagrange_weights:
+ *    computes the barycentric weights w_i = 1/prod_{j != i}(i - j) for the
+ *    nodes 0, ..., n-1. Up to sign, the denominator is i!(n-1-i)!.
+ *
+ * Params:
+ *    uint64 n: the number of nodes
+ *    uint64* w: receives the n weights
+ *
+ * Returns:
+ *    Nothing.
+ */
+void lagrange_weights(uint64 n, uint64* w)
+{
+    if (n == 3 || n == 4)
+    {
+        const uint64* table = (n == 3) ? weights_3 : weights_4;
+        for (uint64 i = 0; i < n; i++)
+            w[i] = table[i];
+        return;
+    }
+
+    uint64* fact = (uint64*) malloc(n*sizeof(uint64));
+    fact[0] = 1;
+    for (uint64 i = 1; i < n; i++)
+        fact[i] = myModMult(fact[i-1], i);
+
+    for (uint64 i = 0; i < n; i++)
+    {
+        w[i] = myModMult(fact[i], fact[n-1-i]);
+        if ((n-1-i) & 1)
+            w[i] = myModCanon(PRIME - myModCanon(w[i]));
+    }
+    batch_inv(w, n, w);
+    free(fact);
+}
+
+/*
+ * extrap:
+ *    extrapolate the polynomial implied by vector vec of length n to location
+ *    r
+ *
+ * Params:
+ *    uint64* vec: the vector to extrapolate
+ *    uint64 n: the length of the vector vec
+ *    uint64 r: the location to extrapolate.
+ *
+ * Returns:
+ *    uint64: the result of the extrapolated point at point r
+ */
+uint64 extrap(uint64* vec, uint64 n, uint64 r)
+{
+    r = myModCanon(r);
+    if (r < n)
+        return myModCanon(vec[r]);
+
+    uint64 stack[2*EXTRAP_STACK];
+    uint64* w = (n <= EXTRAP_STACK) ? stack :
+        (uint64*) malloc(2*n*sizeof(uint64));
+    uint64* suffix = w + n;
+
+    lagrange_weights(n, w);
+
+    // suffix[i] = prod_{j > i} (r - j)
+    uint64 acc = 1;
+    for (uint64 i = n; i-- > 0; )
+    {
+        suffix[i] = acc;
+        acc = myModMult(acc, r + PRIME - i);
+    }
+
+    Fp61Acc result;
+    uint64 prefix = 1;
+    for (uint64 i = 0; i < n; i++)
+    {
+        result.addmul(myModMult(vec[i], w[i]), myModMult(prefix, suffix[i]));
+        prefix = myModMult(prefix, r + PRIME - i);
+    }
+
+    if (w != stack)
+        free(w);
+    return result.value().canonical();
+}
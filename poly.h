@@ -0,0 +1,16 @@
+/*
+ * poly module header file
+ *
+ * This module contains the interpolation of the round polynomials exchanged
+ * in the sum-check protocol.
+ */
+#ifndef POLY_H
+#define POLY_H
+
+#include "math.h"
+
+/* for information on these functions, read poly.cc */
+void lagrange_weights(uint64 n, uint64* w);
+uint64 extrap(uint64* vec, uint64 n, uint64 r);
+
+#endif // POLY_H
@@ -0,0 +1,198 @@
+/*
+ * proof module
+ *
+ * This module contains the reading and writing of proof records and the
+ * start of the Fiat-Shamir transcript that the prover and the verifier
+ * share.
+ */
+#include <iostream>
+
+#include "proof.h"
+
+using namespace std;
+
+/*
+ * proof_open:
+ *    opens the proof file at path for writing or reading.
+ *
+ * Returns:
+ *    Nothing. Exits if the file cannot be opened.
+ */
+void proof_open(proof_stream* ps, const char* path, bool write)
+{
+    ps->file = fopen(path, write ? "wb" : "rb");
+    ps->bytes = 0;
+    if (ps->file == NULL)
+        cout << "Cannot open proof file " << path << endl, exit(1);
+}
+
+/*
+ * proof_attach:
+ *    uses the open stream file (e.g. a channel to another process) as the
+ *    proof.
+ */
+void proof_attach(proof_stream* ps, FILE* file)
+{
+    ps->file = file;
+    ps->bytes = 0;
+}
+
+/*
+ * proof_close:
+ *    flushes and closes the proof stream.
+ */
+void proof_close(proof_stream* ps)
+{
+    fclose(ps->file);
+    ps->file = NULL;
+}
+
+/*
+ * proof_write:
+ *    appends a record of count words to the proof. The record is flushed,
+ *    so that a verifier at the other end of a stream can check it while the
+ *    prover works on the next one.
+ *
+ * Params:
+ *    proof_stream* ps: the proof
+ *    uint32_t type: the type of the record
+ *    const uint64* words: the payload
+ *    uint64 count: the number of words of the payload
+ *
+ * Returns:
+ *    Nothing. Exits if the proof cannot be written or the payload does not
+ *    fit the 32-bit length of a record.
+ */
+void proof_write(proof_stream* ps, uint32_t type, const uint64* words,
+        uint64 count)
+{
+    // the byte length of a payload is stored in 32 bits
+    if (count > UINT32_MAX / sizeof(uint64))
+        cout << "proof record of type " << type << " too large" << endl,
+        exit(1);
+    uint32_t head[2] = {type, (uint32_t)(count*sizeof(uint64))};
+    if (fwrite(head, sizeof(head), 1, ps->file) != 1 ||
+        fwrite(words, sizeof(uint64), count, ps->file) != count ||
+        fflush(ps->file) != 0)
+        cout << "Cannot write the proof" << endl, exit(1);
+    ps->bytes += sizeof(head) + count*sizeof(uint64);
+}
+
+/*
+ * proof_read:
+ *    reads the next record of the proof, which must be of the given type and
+ *    hold count words.
+ *
+ * Params:
+ *    proof_stream* ps: the proof
+ *    uint32_t type: the expected type of the record
+ *    uint64* words: receives the payload
+ *    uint64 count: the expected number of words of the payload
+ *
+ * Returns:
+ *    bool: false if the proof is truncated or the record is not the one
+ *          expected.
+ */
+bool proof_read(proof_stream* ps, uint32_t type, uint64* words, uint64 count)
+{
+    uint32_t head[2];
+    if (fread(head, sizeof(head), 1, ps->file) != 1)
+        return cout << "proof truncated" << endl, false;
+    if (head[0] != type || head[1] != count*sizeof(uint64))
+        return cout << "malformed proof record of type " << head[0] << endl,
+               false;
+    if (fread(words, sizeof(uint64), count, ps->file) != count)
+        return cout << "proof truncated" << endl, false;
+    ps->bytes += sizeof(head) + count*sizeof(uint64);
+    return true;
+}
+
+/*
+ * proof_end:
+ *    checks that the proof ends after the record last read.
+ *
+ * Returns:
+ *    bool: false if there are bytes past the last record.
+ */
+bool proof_end(proof_stream* ps)
+{
+    if (fgetc(ps->file) != EOF)
+        return cout << "trailing bytes after the proof" << endl, false;
+    return true;
+}
+
+/*
+ * proof_header:
+ *    fills in the PROOF_HEADER_WORDS(L) words of the header record of a
+ *    proof about net.
+ */
+void proof_header(vector<layer>& net, int batches, bool separate,
+        bool private_coins, uint64* words)
+{
+    int L = net.size();
+    words[0] = PROOF_MAGIC;
+    words[1] = L;
+    words[2] = batches;
+    words[3] = separate;
+    words[4] = private_coins;
+    for (int i = 0; i < L; i++)
+        layer_shape(&net[i], &words[5 + LAYER_SHAPE_WORDS*i]);
+}
+
+/*
+ * claim_init:
+ *    starts the transcript of a proof and draws the verifier's first claim:
+ *    the header, the digest of the statement and the output are absorbed,
+ *    then the coefficients of the batches and the point the output is
+ *    claimed at are derived. The value of the claim is left to the
+ *    verifier.
+ *
+ * Params:
+ *    claim* c: the claim
+ *    transcript* tr: the transcript, just started (see transcript_init)
+ *    const uint64* header: the header record
+ *    const uint64* statement: the digest of the input, weights and biases
+ *                             (see model_digest), or NULL for a private-coin
+ *                             proof, whose coins do not depend on it
+ *    const uint64* out: the output of the network
+ *    uint64 out_words: the number of words of the output
+ *    int vars: the number of variables of the output of one batch
+ *    int max_vars: the largest number of variables of any claim
+ *    int batches: the number of batches
+ *    arena* mem: the arena the point and the coefficients are allocated from
+ *
+ * Returns:
+ *    Nothing.
+ */
+void claim_init(claim* c, transcript* tr, const uint64* header,
+        const uint64* statement, const uint64* out, uint64 out_words,
+        int vars, int max_vars, int batches, arena* mem)
+{
+    transcript_absorb(tr, header, PROOF_HEADER_WORDS(header[1]));
+    if (statement)
+        transcript_absorb(tr, statement, MODEL_DIGEST_WORDS);
+    transcript_absorb(tr, out, out_words);
+
+    c->batches = batches;
+    c->rho = arena_words(mem, batches);
+    if (batches == 1)
+        c->rho[0] = 1;
+    else
+        transcript_challenges(tr, c->rho, batches);
+
+    c->point = arena_words(mem, max_vars);
+    transcript_challenges(tr, c->point, vars);
+    c->value = 0;
+}
+
+/*
+ * claim_combine:
+ *    returns sum_b rho_b x[b] over the batches of the claim.
+ */
+uint64 claim_combine(const claim* c, const uint64* x)
+{
+    Fp61Acc acc;
+    for (int b = 0; b < c->batches; b++)
+        acc.addmul(x[b], c->rho[b]);
+    return acc.value().canonical();
+}
@@ -0,0 +1,75 @@
+/*
+ * proof module header file
+ *
+ * This module contains the binary format of a non-interactive proof and the
+ * claims the stages of the protocol pass to each other. A proof is a
+ * sequence of records, each a 32-bit type, the 32-bit byte length of its
+ * payload and the payload itself, an array of 64-bit words:
+ *
+ *   PROOF_HEADER   the architecture the proof is about
+ *   PROOF_OUTPUT   the output of the network
+ *   PROOF_BIAS, PROOF_MM, PROOF_SQR, PROOF_BIAS_SQR, PROOF_CONV
+ *                  one per stage, top layer first: the round polynomials of
+ *                  its sum-check followed by the prover's claims about the
+ *                  input of the stage (PROOF_CONV, in place of PROOF_MM for
+ *                  a convolutional layer, holds two sum-checks, each
+ *                  followed by its claim)
+ */
+#ifndef PROOF_H
+#define PROOF_H
+
+#include <cstdio>
+#include <stdint.h>
+#include <vector>
+
+#include "arena.h"
+#include "math.h"
+#include "model.h"
+#include "transcript.h"
+
+#define PROOF_MAGIC 0x534e50524f4f4631ULL  // "SNPROOF1"
+
+#define PROOF_HEADER 1
+#define PROOF_OUTPUT 2
+#define PROOF_BIAS 3
+#define PROOF_MM 4
+#define PROOF_SQR 5
+#define PROOF_BIAS_SQR 6
+#define PROOF_CONV 7
+
+// number of words of the header record of a network of L layers: magic,
+// L, batches, the separate activation flag, the private-coin flag (see
+// cache.h) and the shape of every layer (see layer_shape)
+#define PROOF_HEADER_WORDS(L) (5 + LAYER_SHAPE_WORDS*(L))
+
+struct proof_stream {
+    FILE* file;
+    uint64 bytes;       // bytes written or read so far
+};
+
+// a claim passed from one stage of the proof to the stage below: the MLE of
+// a tensor, combined over the batches with the coefficients rho, is value at
+// point
+struct claim {
+    uint64* point;
+    uint64 value;
+    uint64* rho;
+    int batches;
+};
+
+/* for information on these functions, read proof.cc */
+void proof_open(proof_stream* ps, const char* path, bool write);
+void proof_attach(proof_stream* ps, FILE* file);
+void proof_close(proof_stream* ps);
+void proof_write(proof_stream* ps, uint32_t type, const uint64* words,
+        uint64 count);
+bool proof_read(proof_stream* ps, uint32_t type, uint64* words, uint64 count);
+bool proof_end(proof_stream* ps);
+void proof_header(std::vector<layer>& net, int batches, bool separate,
+        bool private_coins, uint64* words);
+void claim_init(claim* c, transcript* tr, const uint64* header,
+        const uint64* statement, const uint64* out, uint64 out_words,
+        int vars, int max_vars, int batches, arena* mem);
+uint64 claim_combine(const claim* c, const uint64* x);
+
+#endif // PROOF_H
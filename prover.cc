@@ -0,0 +1,1038 @@
+/*
+ * prover module
+ *
+ * This module contains the prover's side of the protocol. The network is
+ * run once, keeping the activations of every layer; the proof then goes
+ * from the output down to the input, every stage proving the claim of the
+ * stage above and handing the stage below a claim about its own input.
+ * Every round polynomial is absorbed into the transcript before the
+ * challenge of its round is derived, and written to the proof.
+ *
+ * The bias and activation stages whose tables do not fit in the arena they
+ * are given (see prover_footprint) stream over the activations instead,
+ * with the sum-checks of stream.cc. With a cluster of worker processes (see
+ * cluster.cc), they and the pre-binding of the matrix multiplications are
+ * run by the workers, each on its slice of the batches.
+ */
+#include "prover.h"
+#include "cluster.h"
+#include "conv.h"
+#include "gemm.h"
+#include "kernels.h"
+#include "mle.h"
+#include "poly.h"
+#include "stats.h"
+#include "stream.h"
+#include "threadpool.h"
+
+using namespace std;
+
+/*
+ * updateV:
+ *    fills in high-order variable xi wih ri
+ *
+ * Params:
+ *    uint64 *V: the vector to operate in.
+ *    int num_new: the number of new values on xi to fill
+ *    uin64 ri: the value to fill the vector with
+ *
+ * Returns:
+ *    Nothing.
+ */
+void updateV(uint64* V, int num_new, uint64 ri)
+{
+    fold_parallel(V, V, V + num_new, num_new, ri);
+}
+
+/*
+ * check_bias_layer:
+ *    runs the d rounds of the sum-check of sum_x eq(q, x) S(x), where
+ *    S = Vin + B and the bias B of p entries is broadcast over the rows of
+ *    Vin (entry x of S adds B[x mod p]). Variables are bound high-order
+ *    first, round i drawing r[d-1-i] from the transcript.
+ *
+ *    The entries of a row of S past p_true are zero (see struct layer).
+ *    While row variables are bound, the pairs of a round are in the same
+ *    column, so those entries stay zero and only the first p_true of every
+ *    row are summed and folded; eq(q, x) is folded whole, as it is read at
+ *    every position once the columns are bound.
+ *
+ * Returns:
+ *    uint64: S~(r), left in S by the folding.
+ */
+uint64 check_bias_layer(uint64* q, uint64* r, int d, uint64 n, uint64 p,
+        uint64 p_true, uint64* Iin, const uint64* Vin, const uint64* B,
+        uint64* F, transcript* tr, arena* scratch)
+{
+    //initialize Iin values
+    eq_table(q, d, Iin);
+
+    uint64* S = arena_words(scratch, n);
+    parallel_for(n, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int) {
+        for (uint64 k=b; k<e; k++)
+            S[k] = myMod(Vin[k] + B[k & (p-1)]);
+    });
+
+    uint64 steps=n;
+    for (int i=0; i<d; i++)
+    {
+        steps = steps >> 1;
+        uint64 sums[3];
+        uint64* Fi = F + 3*i;
+        uint64 rows = (steps >= p) ? steps/p : 1;
+        uint64 len = (steps >= p) ? p_true : steps;
+        stat_scope s;
+        stats_begin(&s, "sums", NULL);
+        round_sums_rows_parallel(Iin, Iin + steps, S, S + steps, rows, p, len,
+                sums, scratch);
+        stats_end(&s);
+        for (int k=0; k<3; k++)
+            Fi[k] = Fp61(sums[k]).canonical();
+        transcript_absorb(tr, Fi, 3);
+        r[d-1-i] = transcript_challenge(tr);
+
+        stats_begin(&s, "fold", NULL);
+        updateV(Iin, steps, r[d-1-i]);
+        fold_rows_parallel(S, S, S + steps, rows, p, len, r[d-1-i]);
+        stats_end(&s);
+    }
+    return myModCanon(S[0]);
+}
+
+/*
+ * prebind_mm:
+ *    binds the e row variables of A and the f column variables of B (the
+ *    variables of the output C) to the point z, leaving two tables over the
+ *    d variables of the inner dimension. Each matrix is read once and left
+ *    untouched; all the folding of the sum-check happens on A and B. With
+ *    several batches, the bound tables of their A matrices are combined with
+ *    the coefficients rho, while B is bound once. The matrices may be stored
+ *    as narrow integers: the bound tables are the first to hold field
+ *    elements.
+ *
+ * Params:
+ *   const void* V0: the list of values of the matrices A of the batches
+ *                   (m x n each) in row-major order, one after another
+ *   int type0: the storage type of V0
+ *   const void* V1: the list of values of matrix B, one row of n per output
+ *                   column (p x n)
+ *   int type1: the storage type of V1
+ *   int d: log n
+ *   int e: log m
+ *   int f: log p
+ *   uint64 n_true, p_true: the true sizes (see struct layer); the columns
+ *                          past n_true and the rows of B past p_true are
+ *                          zero and not read
+ *   int batches: the number of batches
+ *   uint64* rho: the coefficients of the batches (ignored for a single batch)
+ *   uint64* z: the point the output is claimed at; z[0..f-1] are the column
+ *              variables of C, z[f..f+e-1] its row variables
+ *   uint64* A: receives sum_b rho_b A_b(z_row, k) for the n values of k
+ *   uint64* B: receives B(z_col, k) for the n values of k
+ *   arena* scratch: arena the table of a single batch is allocated from
+ *
+ * Returns:
+ *   nothing
+ */
+void prebind_mm(const void* V0, int type0, const void* V1, int type1, int d,
+        int e, int f, uint64 n_true, uint64 p_true, int batches,
+        const uint64* rho, uint64* z, uint64* A, uint64* B, arena* scratch)
+{
+    uint64 n = myPow(2, d);
+    uint64 m = myPow(2, e);
+    if (batches == 1)
+        bind_rows(V0, type0, e, m, n, n_true, z + f, A, scratch);
+    else
+    {
+        uint64* A_b = arena_words(scratch, n);
+        for (uint64 k = 0; k < n; k++)
+            A[k] = 0;
+        for (int b = 0; b < batches; b++)
+        {
+            bind_rows(elem_at(V0, type0, b*m*n), type0, e, m, n, n_true, z + f,
+                    A_b, scratch);
+            scale_add_kernel(A, A_b, rho[b], n_true);
+            stats_count(n_true, 2*n_true*sizeof(uint64));
+        }
+    }
+    bind_rows(V1, type1, f, p_true, n, n_true, z, B, scratch);
+}
+
+/*
+ * sum_check_mm:
+ *    check the result of the matrix multiplication:
+ *
+ * Params:
+ *   uint64* A: matrix A with its row variables bound (see prebind_mm),
+ *              folded in place
+ *   uint64* B: matrix B with its column variables bound, folded in place
+ *   int d: log n, the number of rounds
+ *   int e: log m
+ *   int f: log p
+ *   uint64* r: receives the f+d+e coordinates of the point the inputs are
+ *              reduced to: r[0..d-1] the challenges, r[d..] a copy of z
+ *   uint64* F: receives the d round polynomials, 3 evaluations each
+ *   uint64* z: the point the output is claimed at
+ *   transcript* tr: the transcript the challenges are drawn from
+ *   arena* scratch: arena the partial sums are allocated from
+ *
+ * Returns:
+ *   nothing:
+ *
+ * Notes:
+ *   This function has been modified to incorporate matrix-matrix mult of size (m,n)*(n,p)
+ */
+void sum_check_mm(uint64* A, uint64* B, int d, int e, int f, uint64* r,
+        uint64* F, uint64* z, transcript* tr, arena* scratch)
+{
+
+    for(int i = 0; i < f+e; i++)
+        r[d+i] = z[i];
+
+    int num_terms = myPow(2, d);
+    for(int round = 0; round < d; round++)
+    {
+        uint64 sums[3];
+        uint64 h = num_terms >> 1;
+        uint64* Fi = F + 3*round;
+        stat_scope s;
+        stats_begin(&s, "sums", NULL);
+        round_sums_parallel(A, A + h, B, B + h, h, sums, scratch);
+        stats_end(&s);
+        for(int k = 0; k < 3; k++)
+            Fi[k] = Fp61(sums[k]).canonical();
+        transcript_absorb(tr, Fi, 3);
+        r[d-1-round] = transcript_challenge(tr);
+
+        stats_begin(&s, "fold", NULL);
+        updateV(A, num_terms >> 1, r[d-1-round]);
+        updateV(B, num_terms >> 1, r[d-1-round]);
+        stats_end(&s);
+        num_terms = num_terms >> 1;
+    }
+}
+
+// pairs of a table sqr_rounds folds, then sums, at a time
+#define SQR_BLOCK 256
+
+// V(2k)(1-r) + V(2k+1)r for the pair (a, b)
+static inline uint64 fold2(uint64 a, uint64 b, uint64 r)
+{
+    return myMod(a + myModMult(r, myMod(b + 2*PRIME - a)));
+}
+
+/*
+ * sqr_rounds:
+ *    runs the d rounds of the sum-check of sum_x eq(q, x) S(x)^2, where
+ *    S = Vin, or S = Vin + B when B is not NULL. The bias of p entries is
+ *    broadcast over the rows of Vin and added on the fly whenever Vin is
+ *    read, so S is never materialized. With several batches, Vin holds one
+ *    table of n per batch and the claim is
+ *    sum_b rho_b sum_x eq(q, x) S_b(x)^2; all the batches share q, B and the
+ *    challenges, so their round polynomials are summed with rho. finals
+ *    receives the S_b~(r). See sum_check_bias_sqr_activation for the
+ *    other parameters.
+ *
+ *    The entries of a row of S past p_true are zero (see struct layer).
+ *    While column variables are bound, low-order first, a pair of such
+ *    entries adds nothing to the sums and folds to zero, so only eq(q, x),
+ *    which is read everywhere later on, is folded for it.
+ */
+static void sqr_rounds(uint64* q, uint64* r, int d, uint64 n, uint64* Iin,
+        uint64* I_t, int batches, const uint64* Vin, const uint64* B,
+        uint64 p, uint64 p_true, const uint64* rho, uint64* V_t, uint64* F,
+        uint64* finals, transcript* tr, arena* scratch)
+{
+    //initialize Iin values
+    eq_table(q, d, Iin);
+
+    // the challenge of a round is only known once its sums are, so every
+    // round folds the table of the round before with its challenge while
+    // reading it: round i reads 4 entries of table i-1 per pair (2k, 2k+1)
+    // of its own table, which it writes to another buffer so that the round
+    // can be split across threads. The folds are done a block of
+    // SQR_BLOCK pairs at a time, and the sums of the block are taken by
+    // sqr_sums_kernel while it is still in cache. Rounds 0 and 1 read Vin itself, so Vin is
+    // never copied or modified; later rounds alternate between the
+    // half-sized V_t and the quarter-sized V_h (likewise for I). The tables
+    // of the batches sit stride entries apart in each buffer.
+    uint64 t_stride = n/2 + 1;
+    uint64 h_stride = n/4 + 1;
+    uint64* V_h = arena_words(scratch, batches*h_stride);
+    uint64* I_h = arena_words(scratch, h_stride);
+    const uint64* V_cur = Vin; uint64* V_next = V_t;
+    uint64 cur_stride = n, next_stride = t_stride;
+    const uint64* I_cur = Iin; uint64* I_next = I_t;
+
+    int nthreads = threadpool_size();
+    uint64* partial = arena_words(scratch, 4*nthreads);
+
+    uint64 steps=n;
+    for (int i=0; i<d; i++)
+    {
+        steps = steps >> 1;
+        for (int m=0; m<4*nthreads; m++)
+            partial[m] = 0;
+
+        bool fold = (i > 0);
+        uint64 rp = fold ? r[i-1] : 0;
+        const uint64* bias = (V_cur == Vin) ? B : NULL;
+        // pairs per row of the table of this round, and their non-zero
+        // prefix (every pair is live when the columns are all bound)
+        uint64 half = (p >> i) > 1 ? (p >> i)/2 : 0;
+        uint64 live = (((p_true + ((uint64)1 << i) - 1) >> i) + 1)/2;
+        // the sums and folds of a round are fused, so they are counted
+        // together: per live pair, 4 squares and 4 products with eq per
+        // batch, plus 2 folds per table
+        uint64 pairs = half ? steps/half*live : steps;
+        stats_count(pairs*(8*batches + (fold ? 2*(batches + 1) : 0)),
+                    pairs*(batches + 1)*(fold ? 6 : 2)*sizeof(uint64));
+        parallel_for(steps, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int id) {
+            // the entries of Vin + B of a block, in round 0
+            uint64 vb[2*SQR_BLOCK];
+            Fp61Acc sum[4];
+            for (uint64 k0=b; k0<e; k0+=SQR_BLOCK)
+            {
+                uint64 k1 = (e - k0 < SQR_BLOCK) ? e : k0 + SQR_BLOCK;
+                const uint64* I_blk = I_cur + 2*k0;
+                if (fold)
+                {
+                    for (uint64 k=k0; k<k1; k++)
+                    {
+                        I_next[2*k] = fold2(I_cur[4*k], I_cur[4*k+1], rp);
+                        I_next[2*k+1] = fold2(I_cur[4*k+2], I_cur[4*k+3], rp);
+                    }
+                    I_blk = I_next + 2*k0;
+                }
+
+                for (int t=0; t<batches; t++)
+                {
+                    const uint64* V_in = V_cur + t*cur_stride;
+                    uint64* V_out = fold ? V_next + t*next_stride : NULL;
+                    const uint64* V_blk = fold ? V_out + 2*k0 :
+                                          bias ? vb : V_in + 2*k0;
+                    // the runs of live pairs of the block; the pairs past
+                    // them are zero, and only written when folding
+                    for (uint64 k=k0; k<k1; )
+                    {
+                        uint64 run = k1;
+                        if (half)
+                        {
+                            uint64 row = k - k % half;
+                            if (k - row >= live)
+                            {
+                                run = (row + half < k1) ? row + half : k1;
+                                for (; fold && k<run; k++)
+                                    V_out[2*k] = V_out[2*k+1] = 0;
+                                k = run;
+                                continue;
+                            }
+                            run = (row + live < k1) ? row + live : k1;
+                        }
+                        for (uint64 j=2*k; j<2*run; j++)
+                        {
+                            if (fold)
+                            {
+                                uint64 a = V_in[2*j];
+                                uint64 c = V_in[2*j+1];
+                                if (bias)
+                                {
+                                    a = myMod(a + bias[(2*j) & (p-1)]);
+                                    c = myMod(c + bias[(2*j+1) & (p-1)]);
+                                }
+                                V_out[j] = fold2(a, c, rp);
+                            }
+                            else if (bias)
+                                vb[j - 2*k0] = myMod(V_in[j] +
+                                        bias[j & (p-1)]);
+                        }
+                        uint64 s4[4];
+                        sqr_sums_kernel(I_blk + 2*(k - k0),
+                                V_blk + 2*(k - k0), run - k, s4);
+                        for (int m=0; m<4; m++)
+                            sum[m].add(batches > 1 ?
+                                    myModMult(s4[m], rho[t]) : s4[m]);
+                        k = run;
+                    }
+                }
+            }
+            for (int m=0; m<4; m++)
+                partial[4*id+m] = myMod(partial[4*id+m] + sum[m].value().v);
+        });
+
+        uint64* Fi = F + 4*i;
+        for (int m=0; m<4; m++)
+        {
+            Fp61Acc sum;
+            for (int t=0; t<nthreads; t++)
+                sum.add(partial[4*t+m]);
+            Fi[m] = sum.value().canonical();
+        }
+        transcript_absorb(tr, Fi, 4);
+        r[i] = transcript_challenge(tr);
+
+        if (fold)
+        {
+            V_cur = V_next;
+            I_cur = I_next;
+            cur_stride = next_stride;
+            V_next = (V_next == V_t) ? V_h : V_t;
+            I_next = (I_next == I_t) ? I_h : I_t;
+            next_stride = (V_next == V_t) ? t_stride : h_stride;
+        }
+    }
+
+    // the last table has a single pair left, folded with the last challenge
+    const uint64* bias = (V_cur == Vin) ? B : NULL;
+    for (int t=0; t<batches; t++)
+    {
+        uint64 v0 = V_cur[t*cur_stride];
+        uint64 v1 = V_cur[t*cur_stride + 1];
+        if (bias)
+        {
+            v0 = myMod(v0 + bias[0]);
+            v1 = myMod(v1 + bias[1 & (p-1)]);
+        }
+        finals[t] = myModCanon(fold2(v0, v1, r[d-1]));
+    }
+}
+
+// Protocol reduces verifying a claim that v_i-1(q)=a_i-1 to verifying that
+// v_i(q')=a_i; the claims of the batches are combined with rho. The input of
+// the activation is Vin + B, the bias B being added as Vin is read, so a
+// claim about (Vin+B)^2 at q is reduced to claims about Vin + B at r with a
+// single degree-3 sum-check; B is NULL when Vin already holds it
+void sum_check_bias_sqr_activation(uint64* q, uint64* r, int d, uint64 n,
+        uint64* Iin, uint64* I_t, int batches, const uint64* Vin,
+        const uint64* B, uint64 p, uint64 p_true, const uint64* rho,
+        uint64* V_t, uint64* F, uint64* finals, transcript* tr,
+        arena* scratch)
+{
+    sqr_rounds(q, r, d, n, Iin, I_t, batches, Vin, B, p, p_true, rho, V_t, F,
+            finals, tr, scratch);
+}
+
+
+/*
+ * bias_footprint:
+ *    returns the arena footprint of prove_bias on a layer with e row and f
+ *    column variables.
+ */
+static size_t bias_footprint(int e, int f)
+{
+    int d = e+f;
+    uint64 n = myPow(2,d);
+    uint64 p = myPow(2,f);
+    return 3*arena_words_bytes(n) + arena_words_bytes(p) +
+           arena_words_bytes(3*d + 1) + arena_words_bytes(d) +
+           max(round_sums_bytes(), mle_scratch_bytes(0, f, 1));
+}
+
+/*
+ * mm_footprint:
+ *    returns the arena footprint of prove_mm on a layer of log sizes
+ *    (e, d, f).
+ */
+static size_t mm_footprint(int e, int d, int f)
+{
+    uint64 n = myPow(2, d);
+    return 2*arena_words_bytes(f+d+e) + arena_words_bytes(3*d + 1) +
+           3*arena_words_bytes(n) +
+           max(bind_rows_bytes(max(e, f)), round_sums_bytes());
+}
+
+/*
+ * conv_footprint:
+ *    returns the arena footprint of prove_conv on a layer of log sizes
+ *    (e, d, f), kernel size k and log map size (h, w).
+ */
+static size_t conv_footprint(int e, int d, int f, int k, int h, int w)
+{
+    int kd = conv_weight_vars(d, k, h, w);
+    uint64 n = myPow(2, d);
+    return arena_words_bytes(f+e) + arena_words_bytes(kd+f+e) +
+           arena_words_bytes(e+d) +
+           arena_words_bytes(3*kd + 1 + 3*(e+d) + 1) +
+           2*arena_words_bytes(myPow(2, kd)) +
+           2*arena_words_bytes(myPow(2, e)*n) + 2*arena_words_bytes(n) +
+           conv_tables_bytes(e, d, k, h, w) +
+           max(bind_rows_bytes(max(e, f - h - w)), round_sums_bytes());
+}
+
+/*
+ * sqr_activation_footprint:
+ *    returns the arena footprint of prove_sqr_activation and
+ *    prove_bias_sqr_activation on a layer with d variables.
+ */
+static size_t sqr_activation_footprint(int d, int batches)
+{
+    uint64 n = myPow(2,d);
+    return arena_words_bytes(n) +
+           arena_words_bytes(batches*(n/2 + 1)) + arena_words_bytes(n/2 + 1) +
+           arena_words_bytes(batches*(n/4 + 1)) + arena_words_bytes(n/4 + 1) +
+           arena_words_bytes(4*threadpool_size()) +
+           arena_words_bytes(4*d + batches) + arena_words_bytes(d);
+}
+
+/*
+ * streamed_footprint:
+ *    returns the footprint of a stage that needs whole bytes in memory and
+ *    least bytes streaming (see stream.cc), within budget bytes (0 for no
+ *    budget).
+ */
+static size_t streamed_footprint(size_t whole, size_t least, size_t budget)
+{
+    if (budget == 0 || whole <= budget)
+        return whole;
+    return max(budget, least);
+}
+
+/*
+ * prover_footprint:
+ *    returns the arena footprint of forward and prove_network on a network
+ *    of architecture arch. With a budget (in bytes, 0 for none), the bias
+ *    and activation stages whose tables exceed it are given the budget, and
+ *    stream over the activations, materializing their tables once those
+ *    are folded small enough to fit. The other stages keep their footprint:
+ *    the tables of a matrix multiplication are over its inner dimension
+ *    only, while convolutions are always proven in memory.
+ */
+size_t prover_footprint(vector<int*>& arch, int batches, size_t budget)
+{
+    int L = arch.size();
+    size_t stage = 0;
+    int max_vars = 0;
+    for (int i=0; i<L; i++)
+    {
+        int e = arch[i][0];
+        int d = arch[i][1];
+        int f = arch[i][2];
+        max_vars = max(max_vars, e + max(d, f));
+        int k = arch[i][5];
+        if (k)
+        {
+            stage = max(stage, conv_scratch_bytes(arch[i][6], arch[i][7],
+                        threadpool_size()));
+            stage = max(stage, conv_footprint(e, d, f, k, arch[i][6],
+                        arch[i][7]));
+        }
+        else
+        {
+            stage = max(stage, gemm_scratch_bytes(threadpool_size()));
+            stage = max(stage, mm_footprint(e, d, f));
+        }
+        stage = max(stage, streamed_footprint(bias_footprint(e, f),
+                    max(stream_bias_bytes(e+f), mle_scratch_bytes(0, f, 1)),
+                    budget));
+        stage = max(stage, streamed_footprint(
+                    sqr_activation_footprint(e+f, batches),
+                    stream_sqr_bytes(e+f, batches), budget));
+        stage = max(stage, cluster_footprint(e, f, batches));
+    }
+    return stage + arena_words_bytes(PROOF_HEADER_WORDS(L)) +
+           arena_words_bytes(MODEL_DIGEST_WORDS) +
+           arena_words_bytes(max_vars) + arena_words_bytes(batches);
+}
+
+/*
+ * prove_bias:
+ *    proves the claim c about the output S = Y + b of the bias of layer l
+ *    and reduces it to a claim about Y, which replaces it.
+ */
+runtime prove_bias(layer* l, claim* c, transcript* tr, proof_stream* ps,
+        arena* mem)
+{
+    int d = l->e + l->f;
+    uint64 n = myPow(2,d);
+    uint64 p = myPow(2,l->f);
+    int batches = c->batches;
+    stat_scope stage, part;
+    stats_begin(&stage, "bias", mem);
+    bool stream = bias_footprint(l->e, l->f) > mem->size - arena_mark(mem);
+
+    // the round polynomials followed by the claim about Y
+    uint64* F = arena_words(mem, 3*d + 1);
+
+    uint64* r = arena_words(mem, d);
+
+    // the claim is about sum_b rho_b S_b = sum_b rho_b Y_b + (sum_b rho_b) b,
+    // proven with a single sum-check
+    uint64* rho = c->rho;
+    uint64 rho_sum = 0;
+    for (int b=0; b<batches; b++)
+        rho_sum = myMod(rho_sum + rho[b]);
+
+    uint64 Seval;
+    if (cluster_size())
+    {
+        stats_begin(&part, "cluster", NULL);
+        Seval = cluster_bias_rounds(l, c, r, rho_sum, F, tr, mem);
+        stats_end(&part);
+    }
+    else if (stream)
+    {
+        stats_begin(&part, "stream", NULL);
+        Seval = stream_bias_rounds(c->point, r, d, n, p, batches, l->Y, l->b,
+                rho, rho_sum, F, tr, mem);
+        stats_end(&part);
+    }
+    else
+    {
+        //Iin values, filled in by check_bias_layer
+        uint64* Iin = arena_words(mem, n);
+
+        const uint64* Vc = l->Y;
+        const uint64* Bc = l->b;
+        if (batches > 1)
+        {
+            uint64* Vsum = arena_words(mem, n);
+            uint64* Bsum = arena_words(mem, p);
+            stats_begin(&part, "combine", NULL);
+            combine_parallel(Vsum, l->Y, n, rho, batches);
+            combine_parallel(Bsum, l->b, p, &rho_sum, 1);
+            stats_end(&part);
+            Vc = Vsum;
+            Bc = Bsum;
+        }
+        stats_begin(&part, "rounds", NULL);
+        Seval = check_bias_layer(c->point, r, d, n, p, l->p_true, Iin, Vc, Bc,
+                F, tr, mem);
+        stats_end(&part);
+    }
+
+    // claim about the input of this layer (output of mm mult layer): the
+    // folded S less the bias, whose MLE only depends on the f column
+    // variables
+    stats_begin(&part, "mle", NULL);
+    uint64 Beval = evaluate_V_i(l->f, l->p_true, l->b, r, mem);
+    stats_end(&part);
+    F[3*d] = (Fp61(Seval) - Fp61(myModMult(rho_sum, Beval))).canonical();
+    transcript_absorb(tr, F + 3*d, 1);
+    proof_write(ps, PROOF_BIAS, F, 3*d + 1);
+    double pt = stats_end(&stage);
+    cout << "additional prover time for bias = " << pt << endl;
+
+    for (int i=0; i<d; i++)
+        c->point[i] = r[i];
+
+    runtime bias_runtime;
+    return set_time(bias_runtime, 0, pt, 0);
+}
+
+/*
+ * prove_mm:
+ *    proves the claim c about the output Y = X W^T of layer l and reduces it
+ *    to a claim about its input X, which replaces it.
+ */
+runtime prove_mm(layer* l, claim* c, transcript* tr, proof_stream* ps,
+        arena* mem)
+{
+    int e = l->e;
+    int d = l->d;
+    int f = l->f;
+    uint64 n = myPow(2, d);
+    stat_scope stage, part;
+    stats_begin(&stage, "mm", mem);
+
+    uint64* z = arena_zeros(mem, f+d+e);
+    uint64* r = arena_zeros(mem, f+d+e);
+
+    for(int i = 0; i < f+e; i++)
+        z[i] = c->point[i];
+
+    // the round polynomials followed by the claim about X
+    uint64* F = arena_words(mem, 3*d + 1);
+
+    uint64* A_bound = arena_words(mem, n);
+    uint64* B_bound = arena_words(mem, n);
+
+    // binding the row and column variables of the output is a separate
+    // stage
+    stats_begin(&part, "prebind", NULL);
+    if (cluster_size())
+        cluster_prebind(l, c, z, A_bound, B_bound, mem);
+    else
+        prebind_mm(l->X, l->Xtype, l->W, l->Wtype, d, e, f, l->n_true,
+                l->p_true, c->batches, c->rho, z, A_bound, B_bound, mem);
+    double bt = stats_end(&part);
+    cout << "pre-binding time = " << bt << endl;
+
+    stats_begin(&part, "rounds", NULL);
+    sum_check_mm(A_bound, B_bound, d, e, f, r, F, z, tr, mem);
+    stats_end(&part);
+
+    // claim about the input of this layer (output of sqr activation layer):
+    // the folded A
+    F[3*d] = myModCanon(A_bound[0]);
+    transcript_absorb(tr, F + 3*d, 1);
+    proof_write(ps, PROOF_MM, F, 3*d + 1);
+    double pt = stats_end(&stage);
+    cout << "additional P time for matrix-matrix mult = " << pt << endl;
+
+    // the low-order values of the new point are those of index k, the
+    // high-order ones those of the row index i
+    for(int i = 0; i < d; i++)
+        c->point[i] = r[i];
+    for(int i = d; i < d+e; i++)
+        c->point[i] = r[f+i];
+
+    runtime mm_runtime;
+    return set_time(mm_runtime, 0, pt, 0);
+}
+
+/*
+ * prove_conv:
+ *    proves the claim c about the output Y of the convolutional layer l and
+ *    reduces it to a claim about its input X, which replaces it (see
+ *    conv.cc). The first sum-check runs over the kernel index (c, i, j),
+ *    on the patches of X and the kernel bound to the point of c like the
+ *    matrices of prove_mm; the second over the entries of X (combined over
+ *    the batches), against the table G of conv_input_table.
+ */
+runtime prove_conv(layer* l, claim* c, transcript* tr, proof_stream* ps,
+        arena* mem)
+{
+    int e = l->e;
+    int d = l->d;
+    int f = l->f;
+    int kd = conv_weight_vars(d, l->k, l->h, l->w);
+    uint64 m = myPow(2, e);
+    uint64 n = myPow(2, d);
+    uint64 nw = myPow(2, kd);
+    uint64 hw = myPow(2, l->h + l->w);
+    int batches = c->batches;
+    stat_scope stage, part;
+    stats_begin(&stage, "conv", mem);
+
+    uint64* z = arena_zeros(mem, f+e);
+    uint64* r = arena_zeros(mem, kd+f+e);
+    uint64* q = arena_zeros(mem, e+d);
+    for(int i = 0; i < f+e; i++)
+        z[i] = c->point[i];
+
+    // the round polynomials and claim of the kernel sum-check, then those
+    // of the input sum-check
+    uint64* F = arena_words(mem, 3*kd + 1 + 3*(e+d) + 1);
+    uint64* F_in = F + 3*kd + 1;
+
+    uint64* A_bound = arena_words(mem, nw);
+    uint64* B_bound = arena_words(mem, nw);
+    uint64* Xc = arena_words(mem, m*n);
+    uint64* G = arena_words(mem, m*n);
+
+    stats_begin(&part, "prebind", NULL);
+
+    // the samples of the input are bound first (they are rows, as for
+    // prove_mm), then its pixels, into the patches of every kernel position
+    uint64* Xs = arena_words(mem, n);
+    uint64* Xs_b = arena_words(mem, n);
+    for (uint64 k = 0; k < n; k++)
+        Xs[k] = 0;
+    for (int b = 0; b < batches; b++)
+    {
+        bind_rows(elem_at(l->X, l->Xtype, b*m*n), l->Xtype, e, m, n,
+                l->n_true, z + f, Xs_b, mem);
+        scale_add_kernel(Xs, Xs_b, c->rho[b], l->n_true);
+        stats_count(l->n_true, 2*l->n_true*sizeof(uint64));
+    }
+    conv_bind_patches(Xs, l, z, A_bound, mem);
+    bind_rows(l->W, l->Wtype, f - l->h - l->w, l->p_true/hw, nw, nw,
+            z + l->h + l->w, B_bound, mem);
+    double bt = stats_end(&part);
+    cout << "pre-binding time = " << bt << endl;
+
+    stats_begin(&part, "rounds", NULL);
+    sum_check_mm(A_bound, B_bound, kd, e, f, r, F, z, tr, mem);
+    stats_end(&part);
+    F[3*kd] = myModCanon(A_bound[0]);
+    transcript_absorb(tr, F + 3*kd, 1);
+
+    // the patches at (z, r) are a product of the input with G
+    stats_begin(&part, "input", NULL);
+    stats_count(batches*m*n, (batches*elem_bytes(l->Xtype) +
+                sizeof(uint64))*m*n);
+    parallel_for(m*n, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int) {
+        for (uint64 k = b; k < e; k++)
+        {
+            Fp61Acc x;
+            for (int s = 0; s < batches; s++)
+                x.addmul(elem_get(l->X, l->Xtype, s*m*n + k), c->rho[s]);
+            Xc[k] = x.value().v;
+        }
+    });
+    conv_input_table(l, r, z, G, mem);
+    sum_check_mm(Xc, G, e+d, 0, 0, q, F_in, NULL, tr, mem);
+    stats_end(&part);
+    F_in[3*(e+d)] = myModCanon(Xc[0]);
+    transcript_absorb(tr, F_in + 3*(e+d), 1);
+    proof_write(ps, PROOF_CONV, F, 3*kd + 1 + 3*(e+d) + 1);
+    double pt = stats_end(&stage);
+    cout << "additional P time for convolution = " << pt << endl;
+
+    for(int i = 0; i < e+d; i++)
+        c->point[i] = q[i];
+
+    runtime conv_runtime;
+    return set_time(conv_runtime, 0, pt, 0);
+}
+
+/*
+ * sqr_stage:
+ *    runs the sum-check of the square activation of layer l on the claim c,
+ *    with the bias added (prove_bias_sqr_activation) or already proven
+ *    below (prove_sqr_activation); the two stages only differ in the record
+ *    written.
+ */
+static runtime sqr_stage(layer* l, claim* c, transcript* tr,
+        proof_stream* ps, uint32_t type, arena* mem)
+{
+    int d = l->e + l->f;
+    uint64 n = myPow(2,d);
+    uint64 p = myPow(2,l->f);
+    int batches = c->batches;
+    stat_scope stage, part;
+    stats_begin(&stage, type == PROOF_SQR ? "sqr" : "bias_sqr", mem);
+    bool stream = sqr_activation_footprint(d, batches) >
+                  mem->size - arena_mark(mem);
+
+    // the round polynomials followed by the claims about Y + b, one per
+    // batch
+    uint64* F = arena_words(mem, 4*d + batches);
+
+    uint64* r = arena_words(mem, d);
+
+    if (cluster_size())
+    {
+        stats_begin(&part, "cluster", NULL);
+        cluster_sqr_rounds(l, c, r, F, F + 4*d, tr, mem);
+        stats_end(&part);
+    }
+    else if (stream)
+    {
+        stats_begin(&part, "stream", NULL);
+        stream_sqr_rounds(c->point, r, d, n, batches, l->Y, l->b, p, c->rho,
+                F, F + 4*d, tr, mem);
+        stats_end(&part);
+    }
+    else
+    {
+        // table for V_tilda holding contributions of initial Vin+Bs at each
+        // round; it starts at half the size of Vin
+        uint64* V_t = arena_words(mem, batches*(n/2 + 1));
+
+        //Iin values, filled in by sqr_rounds
+        uint64* Iin = arena_words(mem, n);
+        uint64* I_t = arena_words(mem, n/2 + 1);
+
+        stats_begin(&part, "rounds", NULL);
+        sum_check_bias_sqr_activation(c->point, r, d, n, Iin, I_t, batches,
+                l->Y, l->b, p, l->p_true, c->rho, V_t, F, F + 4*d, tr, mem);
+        stats_end(&part);
+    }
+    transcript_absorb(tr, F + 4*d, batches);
+    proof_write(ps, type, F, 4*d + batches);
+    double pt = stats_end(&stage);
+    cout << "additional prover time for "
+         << (type == PROOF_SQR ? "sqr activation" : "bias and sqr activation")
+         << " = " << pt << endl;
+
+    for (int i=0; i<d; i++)
+        c->point[i] = r[i];
+
+    runtime sqr_runtime;
+    return set_time(sqr_runtime, 0, pt, 0);
+}
+
+/*
+ * prove_sqr_activation:
+ *    proves the claim c about the output (Y + b)^2 of the activation of
+ *    layer l and reduces it to a claim about S = Y + b, which replaces it.
+ */
+runtime prove_sqr_activation(layer* l, claim* c, transcript* tr,
+        proof_stream* ps, arena* mem)
+{
+    return sqr_stage(l, c, tr, ps, PROOF_SQR, mem);
+}
+
+/*
+ * prove_bias_sqr_activation:
+ *    proves the claim c about the output (Y + b)^2 of the bias and
+ *    activation of layer l and reduces it to a claim about Y, which replaces
+ *    it.
+ */
+runtime prove_bias_sqr_activation(layer* l, claim* c, transcript* tr,
+        proof_stream* ps, arena* mem)
+{
+    return sqr_stage(l, c, tr, ps, PROOF_BIAS_SQR, mem);
+}
+
+
+/*
+ * forward:
+ *    runs the network on its input: computes Y of every layer and the input
+ *    X of the next one (the square of Y plus the bias), or, at the last
+ *    layer, the output Y + b of the network into out. With a cluster, the
+ *    workers run it on their slices and only out is filled in here.
+ *
+ * Returns:
+ *    runtime: the (unverifiable) time of the whole inference.
+ */
+runtime forward(vector<layer>& net, int batches, uint64* out, arena* scratch)
+{
+    if (cluster_size())
+        return cluster_forward(net, batches, out);
+
+    int L = net.size();
+    double ut_total = 0;
+    size_t base = arena_mark(scratch);
+    stat_scope top, part;
+    stats_begin(&top, "forward", scratch);
+    for (int i=0; i<L; i++)
+    {
+        layer* l = &net[i];
+        uint64 n = myPow(2, l->d);
+        uint64 m = myPow(2, l->e);
+        uint64 p = myPow(2, l->f);
+
+        arena_release(scratch, base);
+        stats_layer(i+1);
+        stats_begin(&part, l->k ? "conv" : "gemm", scratch);
+        for (int b=0; b<batches && l->k; b++)
+            conv_forward(elem_at(l->X, l->Xtype, b*m*n), l->Xtype, l->W,
+                    l->Wtype, l->Y + b*m*p, l, scratch);
+        for (int b=0; b<batches && !l->k; b++)
+            gemm_mod(elem_at(l->X, l->Xtype, b*m*n), l->Xtype, l->W,
+                    l->Wtype, l->Y + b*m*p, m, n, p, l->n_true, l->p_true,
+                    scratch);
+        double mt = stats_end(&part);
+        // a convolution multiplies every input pixel by k x k weights per
+        // output channel
+        double flops = l->k ? 2.0*batches*m*l->n_true*l->p_true*l->k*l->k /
+                              myPow(2, l->h + l->w) :
+                              2.0*batches*m*l->n_true*l->p_true;
+        cout << "unverifiable time for "
+             << (l->k ? "convolution" : "matrix-matrix mult") << " of layer "
+             << i+1 << " = " << mt << endl;
+        cout << (l->k ? "convolution" : "matrix-matrix mult")
+             << " throughput = " << flops/mt*1e-9 << " GFLOP/s" << endl;
+
+        uint64* next = (i == L-1) ? out : (uint64*) net[i+1].X;
+        stats_begin(&part, "activation", NULL);
+        stats_count(batches*m*p, 3*batches*m*p*sizeof(uint64));
+        for (uint64 k=0; k<batches*m*p; k++)
+        {
+            uint64 s = myMod(l->Y[k] + l->b[k & (p-1)]);
+            next[k] = (i == L-1) ? myModCanon(s) : myModMult(s, s);
+        }
+        double at = stats_end(&part);
+        cout << "unverifiable time for bias and sqr activation of layer "
+             << i+1 << " = " << at << endl;
+
+        ut_total += mt + at;
+    }
+    arena_release(scratch, base);
+    stats_layer(0);
+    stats_end(&top);
+
+    runtime forward_runtime;
+    return set_time(forward_runtime, ut_total, 0, 0);
+}
+
+/*
+ * prove_network:
+ *    writes the proof that out is the output of net (run by forward on
+ *    batches batches) to ps: the header, the output and the records of every
+ *    stage from the output layer down.
+ *
+ * Params:
+ *    vector<layer>& net: the network, with the activations of its forward
+ *                        pass
+ *    int batches: the number of batches
+ *    bool separate: prove the bias and the square activation of hidden
+ *                   layers as two separate stages
+ *    uint64* out: the output of the network
+ *    int peer: the coin channel of a private-coin proof, which the
+ *              challenges are asked for on (see channel_coin), or -1 for a
+ *              Fiat-Shamir one
+ *    proof_stream* ps: the proof
+ *    arena* mem: the arena the stages allocate from
+ *
+ * Returns:
+ *    runtime: the additional prover time of all the stages.
+ */
+runtime prove_network(vector<layer>& net, int batches, bool separate,
+        uint64* out, int peer, proof_stream* ps, arena* mem)
+{
+    int L = net.size();
+    int max_vars = 0;
+    for (int i=0; i<L; i++)
+        max_vars = max(max_vars, net[i].e + max(net[i].d, net[i].f));
+    stat_scope top;
+    stats_layer(0);
+    stats_begin(&top, "prove", mem);
+    layer* last = &net[L-1];
+    int out_vars = last->e + last->f;
+    uint64 out_words = batches*myPow(2, out_vars);
+
+    uint64* header = arena_words(mem, PROOF_HEADER_WORDS(L));
+    proof_header(net, batches, separate, peer >= 0, header);
+    proof_write(ps, PROOF_HEADER, header, PROOF_HEADER_WORDS(L));
+    proof_write(ps, PROOF_OUTPUT, out, out_words);
+
+    // the challenges of a Fiat-Shamir proof depend on the input and the
+    // parameters it is about
+    uint64* statement = NULL;
+    if (peer < 0)
+    {
+        statement = arena_words(mem, MODEL_DIGEST_WORDS);
+        model_digest(net, batches, statement);
+    }
+    transcript tr;
+    transcript_init(&tr, "safetynets");
+    if (peer >= 0)
+        transcript_use_peer(&tr, peer);
+    claim c;
+    claim_init(&c, &tr, header, statement, out, out_words, out_vars, max_vars,
+            batches, mem);
+
+    runtime total_time;
+    total_time = set_time(total_time, 0, 0, 0);
+    size_t base = arena_mark(mem);
+    for (int i=L-1; i>=0; i--)
+    {
+        cout << "======== Layer " << i+1 << " proof =======" << endl;
+        layer* l = &net[i];
+        stats_layer(i+1);
+
+        // no activation in the last layer
+        if (i!=L-1 && !separate)
+        {
+            arena_release(mem, base);
+            total_time = update_time(total_time,
+                    prove_bias_sqr_activation(l, &c, &tr, ps, mem));
+        }
+        else
+        {
+            if (i!=L-1)
+            {
+                arena_release(mem, base);
+                total_time = update_time(total_time,
+                        prove_sqr_activation(l, &c, &tr, ps, mem));
+            }
+
+            arena_release(mem, base);
+            total_time = update_time(total_time,
+                    prove_bias(l, &c, &tr, ps, mem));
+        }
+
+        arena_release(mem, base);
+        total_time = update_time(total_time, l->k ?
+                prove_conv(l, &c, &tr, ps, mem) :
+                prove_mm(l, &c, &tr, ps, mem));
+    }
+    arena_release(mem, base);
+    stats_layer(0);
+    stats_end(&top);
+
+    return total_time;
+}
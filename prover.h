@@ -0,0 +1,53 @@
+/*
+ * prover module header file
+ *
+ * This module contains the prover's side of the protocol: the forward pass
+ * of the network and the sum-checks of every stage, whose messages are
+ * written to a proof and whose challenges come from a Fiat-Shamir
+ * transcript.
+ */
+#ifndef PROVER_H
+#define PROVER_H
+
+#include <vector>
+
+#include "arena.h"
+#include "math.h"
+#include "model.h"
+#include "proof.h"
+#include "transcript.h"
+#include "util.h"
+
+/* for information on these functions, read prover.cc */
+void updateV(uint64* V, int num_new, uint64 ri);
+uint64 check_bias_layer(uint64* q, uint64* r, int d, uint64 n, uint64 p,
+        uint64 p_true, uint64* Iin, const uint64* Vin, const uint64* B,
+        uint64* F, transcript* tr, arena* scratch);
+void prebind_mm(const void* V0, int type0, const void* V1, int type1, int d,
+        int e, int f, uint64 n_true, uint64 p_true, int batches,
+        const uint64* rho, uint64* z, uint64* A, uint64* B, arena* scratch);
+void sum_check_mm(uint64* A, uint64* B, int d, int e, int f, uint64* r,
+        uint64* F, uint64* z, transcript* tr, arena* scratch);
+void sum_check_bias_sqr_activation(uint64* q, uint64* r, int d, uint64 n,
+        uint64* Iin, uint64* I_t, int batches, const uint64* Vin,
+        const uint64* B, uint64 p, uint64 p_true, const uint64* rho,
+        uint64* V_t, uint64* F, uint64* finals, transcript* tr,
+        arena* scratch);
+size_t prover_footprint(std::vector<int*>& arch, int batches,
+        size_t budget);
+runtime forward(std::vector<layer>& net, int batches, uint64* out,
+        arena* scratch);
+runtime prove_bias(layer* l, claim* c, transcript* tr, proof_stream* ps,
+        arena* mem);
+runtime prove_mm(layer* l, claim* c, transcript* tr, proof_stream* ps,
+        arena* mem);
+runtime prove_conv(layer* l, claim* c, transcript* tr, proof_stream* ps,
+        arena* mem);
+runtime prove_sqr_activation(layer* l, claim* c, transcript* tr,
+        proof_stream* ps, arena* mem);
+runtime prove_bias_sqr_activation(layer* l, claim* c, transcript* tr,
+        proof_stream* ps, arena* mem);
+runtime prove_network(std::vector<layer>& net, int batches, bool separate,
+        uint64* out, int peer, proof_stream* ps, arena* mem);
+
+#endif // PROVER_H
@@ -8,6 +8,7 @@
 #include <math.h>
 #include <string>
 #include <fstream>
+#include <unistd.h>
 
 #include <sstream>
 #include <vector>
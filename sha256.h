@@ -0,0 +1,28 @@
+/*
+ * sha256 module header file
+ *
+ * This module contains a self-contained implementation of the SHA-256 hash
+ * function (FIPS 180-4), which the Fiat-Shamir transcript derives the
+ * challenges of the protocol from.
+ */
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#define SHA256_DIGEST_BYTES 32
+
+struct sha256_ctx {
+    uint32_t state[8];
+    uint64_t length;        // bytes hashed so far
+    unsigned char block[64];
+    size_t fill;            // bytes buffered in block
+};
+
+/* for information on these functions, read sha256.cc */
+void sha256_init(sha256_ctx* ctx);
+void sha256_update(sha256_ctx* ctx, const void* data, size_t len);
+void sha256_final(sha256_ctx* ctx, unsigned char* digest);
+
+#endif // SHA256_H
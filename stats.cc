@@ -0,0 +1,244 @@
+/*
+ * stats module
+ *
+ * This module keeps one record per (scope name, layer): how many times the
+ * scope ran and, summed over the runs, its wall-clock time, the CPU time of
+ * the whole process (every thread) meanwhile, and the modular multiplies
+ * and bytes the kernels it called reported with stats_count, as well as the
+ * peak use of the arena it was given. The counts are derived from the
+ * shapes the kernels are called on, one stats_count per call rather than
+ * per element, so they cost nothing on the hot path. A record's counts
+ * include those of the scopes nested in it.
+ *
+ * Only the thread that runs the stages opens scopes; stats_count may be
+ * called from any thread.
+ */
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include "stats.h"
+#include "util.h"
+
+using namespace std;
+
+struct stat_record {
+    string name;
+    int layer;
+    uint64 calls;
+    double wall, cpu;
+    uint64 mults, bytes;
+    size_t peak;
+};
+
+static vector<stat_record> records;
+static vector<string> open_scopes;
+static vector<pair<string, string> > summary;
+static int current_layer = 0;
+static atomic<uint64> count_mults(0);
+static atomic<uint64> count_bytes(0);
+
+/*
+ * cpu_time:
+ *    returns the CPU time of the process, all threads included, in seconds.
+ */
+double cpu_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+/*
+ * stats_layer:
+ *    sets the layer (numbered from 1, 0 for the whole network) the scopes
+ *    begun from now on are about.
+ */
+void stats_layer(int layer)
+{
+    current_layer = layer;
+}
+
+/*
+ * stats_begin:
+ *    begins the scope s, named name within the scopes already open. If mem
+ *    is not NULL, the peak use of mem during the scope is recorded.
+ */
+void stats_begin(stat_scope* s, const char* name, arena* mem)
+{
+    string full = open_scopes.empty() ? string(name) :
+                  open_scopes.back() + "/" + name;
+    s->depth = open_scopes.size();
+    open_scopes.push_back(full);
+
+    s->record = -1;
+    for (size_t k = 0; k < records.size(); k++)
+        if (records[k].layer == current_layer && records[k].name == full)
+            s->record = k;
+    if (s->record < 0)
+    {
+        stat_record r = {full, current_layer, 0, 0, 0, 0, 0, 0};
+        records.push_back(r);
+        s->record = records.size() - 1;
+    }
+
+    s->mem = mem;
+    if (mem)
+    {
+        s->peak = mem->peak;
+        mem->peak = mem->used;
+    }
+    s->mults = count_mults.load(memory_order_relaxed);
+    s->bytes = count_bytes.load(memory_order_relaxed);
+    s->cpu = cpu_time();
+    s->wall = wall_time();
+}
+
+/*
+ * stats_end:
+ *    ends the scope s and adds its run to its record.
+ *
+ * Returns:
+ *    double: the wall-clock time of the scope, in seconds.
+ */
+double stats_end(stat_scope* s)
+{
+    double wall = wall_time() - s->wall;
+    double cpu = cpu_time() - s->cpu;
+    stat_record* r = &records[s->record];
+    r->calls++;
+    r->wall += wall;
+    r->cpu += cpu;
+    r->mults += count_mults.load(memory_order_relaxed) - s->mults;
+    r->bytes += count_bytes.load(memory_order_relaxed) - s->bytes;
+    if (s->mem)
+    {
+        if (s->mem->peak > r->peak)
+            r->peak = s->mem->peak;
+        if (s->peak > s->mem->peak)
+            s->mem->peak = s->peak;
+    }
+    open_scopes.pop_back();
+    return wall;
+}
+
+/*
+ * stats_abort:
+ *    closes the scope s, and the scopes begun within it, without adding
+ *    their runs to their records, when a failure cuts them short.
+ */
+void stats_abort(stat_scope* s)
+{
+    open_scopes.resize(s->depth);
+    if (s->mem && s->peak > s->mem->peak)
+        s->mem->peak = s->peak;
+}
+
+/*
+ * stats_count:
+ *    adds mults modular multiplies and bytes bytes of memory traffic to the
+ *    open scopes.
+ */
+void stats_count(uint64 mults, uint64 bytes)
+{
+    count_mults.fetch_add(mults, memory_order_relaxed);
+    count_bytes.fetch_add(bytes, memory_order_relaxed);
+}
+
+/*
+ * stats_set, stats_set_text:
+ *    set a summary value of the report (a number or a text), replacing any
+ *    earlier value of key.
+ */
+void stats_set(const char* key, double value)
+{
+    char text[64];
+    snprintf(text, sizeof(text), "%.9g", value);
+    for (size_t k = 0; k < summary.size(); k++)
+        if (summary[k].first == key)
+        {
+            summary[k].second = text;
+            return;
+        }
+    summary.push_back(make_pair(string(key), string(text)));
+}
+
+void stats_set_text(const char* key, const char* value)
+{
+    string quoted = "\"";
+    for (const char* c = value; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            quoted += '\\';
+        quoted += *c;
+    }
+    quoted += "\"";
+    for (size_t k = 0; k < summary.size(); k++)
+        if (summary[k].first == key)
+        {
+            summary[k].second = quoted;
+            return;
+        }
+    summary.push_back(make_pair(string(key), quoted));
+}
+
+/*
+ * stats_write:
+ *    writes the report to path: CSV if path ends in ".csv" (the summary as
+ *    "# key = value" lines, then one row per record), JSON otherwise (an
+ *    object with the summary and the array of records).
+ *
+ * Returns:
+ *    Nothing. Exits if the report cannot be written.
+ */
+void stats_write(const char* path)
+{
+    string p = path;
+    bool csv = p.size() >= 4 && p.compare(p.size() - 4, 4, ".csv") == 0;
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+        cout << "Cannot write the report " << path << endl, exit(1);
+
+    if (csv)
+    {
+        for (size_t k = 0; k < summary.size(); k++)
+            fprintf(file, "# %s = %s\n", summary[k].first.c_str(),
+                    summary[k].second.c_str());
+        fprintf(file, "name,layer,calls,wall,cpu,mults,bytes,peak\n");
+        for (size_t k = 0; k < records.size(); k++)
+        {
+            stat_record* r = &records[k];
+            fprintf(file, "%s,%d,%llu,%.9g,%.9g,%llu,%llu,%zu\n",
+                    r->name.c_str(), r->layer,
+                    (unsigned long long) r->calls, r->wall, r->cpu,
+                    (unsigned long long) r->mults,
+                    (unsigned long long) r->bytes, r->peak);
+        }
+    }
+    else
+    {
+        fprintf(file, "{\n  \"summary\": {");
+        for (size_t k = 0; k < summary.size(); k++)
+            fprintf(file, "%s\n    \"%s\": %s", k ? "," : "",
+                    summary[k].first.c_str(), summary[k].second.c_str());
+        fprintf(file, "\n  },\n  \"stages\": [");
+        for (size_t k = 0; k < records.size(); k++)
+        {
+            stat_record* r = &records[k];
+            fprintf(file, "%s\n    {\"name\": \"%s\", \"layer\": %d, "
+                    "\"calls\": %llu, \"wall\": %.9g, \"cpu\": %.9g, "
+                    "\"mults\": %llu, \"bytes\": %llu, \"peak\": %zu}",
+                    k ? "," : "", r->name.c_str(), r->layer,
+                    (unsigned long long) r->calls, r->wall, r->cpu,
+                    (unsigned long long) r->mults,
+                    (unsigned long long) r->bytes, r->peak);
+        }
+        fprintf(file, "\n  ]\n}\n");
+    }
+
+    if (fclose(file) != 0)
+        cout << "Cannot write the report " << path << endl, exit(1);
+}
@@ -0,0 +1,41 @@
+/*
+ * stats module header file
+ *
+ * This module contains the instrumentation of the prover and the verifier:
+ * scoped wall-clock and CPU timers around the stages and their parts,
+ * counters of modular multiplies and bytes touched, the peak arena use of
+ * every stage, and the machine-readable report (JSON or CSV) they add up
+ * to.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstddef>
+
+#include "arena.h"
+#include "math.h"
+
+// a scope being timed, from stats_begin to stats_end. Scopes nest: the
+// record of a scope is named after the scopes it is in, and it is about the
+// layer set by stats_layer when it begins.
+struct stat_scope {
+    int record;
+    size_t depth;       // the number of scopes open around it
+    double wall, cpu;
+    uint64 mults, bytes;
+    arena* mem;
+    size_t peak;
+};
+
+/* for information on these functions, read stats.cc */
+double cpu_time();
+void stats_layer(int layer);
+void stats_begin(stat_scope* s, const char* name, arena* mem);
+double stats_end(stat_scope* s);
+void stats_abort(stat_scope* s);
+void stats_count(uint64 mults, uint64 bytes);
+void stats_set(const char* key, double value);
+void stats_set_text(const char* key, const char* value);
+void stats_write(const char* path);
+
+#endif // STATS_H
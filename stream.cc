@@ -0,0 +1,532 @@
+/*
+ * stream module
+ *
+ * This module contains the sum-checks of the bias and square activation
+ * stages for layers whose tables do not fit in the arena of the prover.
+ * Those tables have an entry per output of the layer and batch; the
+ * in-memory sum-checks of prover.cc fill one with Y + b and eq(q, x) and
+ * halve them every round. Here the first rounds are streaming reductions
+ * over Y itself, read once per round in order, from memory, a spill file
+ * (see arena_init_file) or a mapped model file alike:
+ *
+ *  - after i rounds, an entry of the folded Y + b is a combination, with
+ *    the eq table w of the i challenges, of the 2^i entries of Y + b folded
+ *    into it, so it is computed on the fly from them;
+ *  - eq(q, x) folded with the same challenges is eq over the free
+ *    variables times a constant, and is computed on the fly from two
+ *    tables over the low and high halves of those variables.
+ *
+ * As soon as the folded tables fit in the arena, they are materialized and
+ * the remaining rounds run in memory. The sums of every round, and so the
+ * proof, are those of the in-memory sum-checks.
+ */
+#include "kernels.h"
+#include "mle.h"
+#include "stats.h"
+#include "stream.h"
+#include "threadpool.h"
+
+using namespace std;
+
+// entries of the folded table a thread computes at a time in
+// stream_bias_rounds and stream_sqr_rounds
+#define STREAM_CHUNK 4096
+
+// eq(q, x) over vars variables, times a constant, as the product of a table
+// over the low half of the bits of x and one over the high half
+struct split_eq {
+    int lo;
+    uint64 mask;
+    uint64* low;
+    uint64* high;
+};
+
+/*
+ * split_eq_bytes:
+ *    returns the arena footprint of a split_eq over vars variables.
+ */
+static size_t split_eq_bytes(int vars)
+{
+    return arena_words_bytes((uint64)1 << (vars/2)) +
+           arena_words_bytes((uint64)1 << (vars - vars/2));
+}
+
+/*
+ * split_eq_init:
+ *    fills s with scale * eq(point, x), point having vars coordinates.
+ */
+static void split_eq_init(split_eq* s, uint64* point, int vars, uint64 scale,
+        arena* mem)
+{
+    uint64 high_size = (uint64)1 << (vars - vars/2);
+    s->lo = vars/2;
+    s->mask = ((uint64)1 << s->lo) - 1;
+    s->low = arena_words(mem, (uint64)1 << s->lo);
+    s->high = arena_words(mem, high_size);
+    eq_table(point, s->lo, s->low);
+    eq_table(point + s->lo, vars - s->lo, s->high);
+    for (uint64 k = 0; k < high_size; k++)
+        s->high[k] = myModMult(s->high[k], scale);
+}
+
+// entry x of the split_eq s
+static inline uint64 split_eq_at(const split_eq* s, uint64 x)
+{
+    return myModMult(s->low[x & s->mask], s->high[x >> s->lo]);
+}
+
+// eq(a, b) of a single variable: ab + (1-a)(1-b)
+static inline uint64 eq_var(uint64 a, uint64 b)
+{
+    return myMod(2*myModMult(a, b) + 1 + 4*PRIME - a - b);
+}
+
+// entry x of S = sum_b rho_b (Y_b + B), the bias of p entries broadcast
+// over the rows; S = Y + B for a single batch, as in prove_bias
+static inline uint64 bias_entry(const uint64* Y, const uint64* B, uint64 n,
+        uint64 p, int batches, const uint64* rho, uint64 rho_sum, uint64 x)
+{
+    if (batches == 1)
+        return myMod(Y[x] + B[x & (p-1)]);
+    Fp61Acc s;
+    for (int t = 0; t < batches; t++)
+        s.addmul(Y[t*n + x], rho[t]);
+    s.addmul(B[x & (p-1)], rho_sum);
+    return s.value().v;
+}
+
+/*
+ * stream_bias_bytes:
+ *    returns the least arena footprint of stream_bias_rounds on d
+ *    variables: with it, the tables are materialized halfway through the
+ *    rounds at the latest.
+ */
+size_t stream_bias_bytes(int d)
+{
+    int half = (d + 1)/2;
+    int nthreads = threadpool_size();
+    return arena_words_bytes(3*nthreads) +
+           arena_words_bytes(2*STREAM_CHUNK*nthreads) +
+           arena_words_bytes((uint64)1 << half) + split_eq_bytes(d) +
+           2*arena_words_bytes((uint64)1 << (d - half)) + round_sums_bytes();
+}
+
+/*
+ * stream_bias_rounds:
+ *    check_bias_layer (see prover.cc) on S = sum_b rho_b (Y_b + B), without
+ *    holding S or eq(q, x) in memory. Variables are bound high-order first,
+ *    so after i rounds entry j of the folded S is sum_c w_c S(c 2^(d-i) + j)
+ *    and a round reads the 2^i blocks of Y in chunks of STREAM_CHUNK
+ *    entries, each chunk folded into a buffer of its thread.
+ *
+ * Params:
+ *    uint64* q: the point of the claim, d coordinates
+ *    uint64* r: receives the d challenges
+ *    int d: the number of variables
+ *    uint64 n: 2^d
+ *    uint64 p: the length of a row of Y, and of B
+ *    int batches: the number of batches
+ *    const uint64* Y: the tables of the batches, n entries each
+ *    const uint64* B: the bias
+ *    const uint64* rho: the coefficients of the batches (ignored for a
+ *                       single batch)
+ *    uint64 rho_sum: the sum of rho
+ *    uint64* F: receives the d round polynomials, 3 evaluations each
+ *    transcript* tr: the transcript the challenges are drawn from
+ *    arena* mem: the arena the tables are allocated from
+ *
+ * Returns:
+ *    uint64: S~(r). The tables are released.
+ */
+uint64 stream_bias_rounds(uint64* q, uint64* r, int d, uint64 n, uint64 p,
+        int batches, const uint64* Y, const uint64* B, const uint64* rho,
+        uint64 rho_sum, uint64* F, transcript* tr, arena* mem)
+{
+    size_t base = arena_mark(mem);
+    int nthreads = threadpool_size();
+    uint64* partial = arena_words(mem, 3*nthreads);
+    uint64* buffers = arena_words(mem, 2*STREAM_CHUNK*nthreads);
+    arena_sequential(Y, batches*n*sizeof(uint64), true);
+
+    // eq(q, r) over the bound variables
+    uint64 scale = 1;
+    uint64* S = NULL;
+    uint64* I = NULL;
+    uint64 size = n;
+    int i = 0;
+    for (; i < d; i++, size >>= 1)
+    {
+        size_t mark = arena_mark(mem);
+        uint64 h = size/2;
+        uint64 blocks = (uint64)1 << i;
+        uint64* w = arena_words(mem, blocks);
+        eq_table(r + d - i, i, w);
+        split_eq eq;
+        split_eq_init(&eq, q, d - i, scale, mem);
+        stat_scope s;
+
+        if (2*arena_words_bytes(size) + round_sums_bytes() <=
+                mem->size - arena_mark(mem) || size == 2)
+        {
+            stats_begin(&s, "materialize", NULL);
+            stats_count(n*(batches + 1) + size,
+                    (batches*n + 2*size)*sizeof(uint64));
+            S = arena_words(mem, size);
+            I = arena_words(mem, size);
+            parallel_for(size, STREAM_CHUNK, [&](uint64 b, uint64 e, int) {
+                for (uint64 j = b; j < e; j++)
+                {
+                    S[j] = 0;
+                    I[j] = split_eq_at(&eq, j);
+                }
+                for (uint64 c = 0; c < blocks; c++)
+                    for (uint64 j = b; j < e; j++)
+                        S[j] = myMod(S[j] + myModMult(w[c], bias_entry(Y, B,
+                                        n, p, batches, rho, rho_sum,
+                                        c*size + j)));
+            });
+            stats_end(&s);
+            break;
+        }
+
+        stats_begin(&s, "pass", NULL);
+        stats_count(n*(batches + 1) + 5*size, batches*n*sizeof(uint64));
+        for (int k = 0; k < 3*nthreads; k++)
+            partial[k] = 0;
+        parallel_for(h, STREAM_CHUNK, [&](uint64 b, uint64 e, int id) {
+            uint64* lo = buffers + 2*STREAM_CHUNK*id;
+            uint64* hi = lo + STREAM_CHUNK;
+            Fp61Acc temp0; Fp61Acc temp1; Fp61Acc cross;
+            for (uint64 j0 = b; j0 < e; j0 += STREAM_CHUNK)
+            {
+                uint64 len = (e - j0 < STREAM_CHUNK) ? e - j0 : STREAM_CHUNK;
+                for (uint64 j = 0; j < len; j++)
+                    lo[j] = hi[j] = 0;
+                for (uint64 c = 0; c < blocks; c++)
+                {
+                    uint64 base = c*size + j0;
+                    for (uint64 j = 0; j < len; j++)
+                    {
+                        lo[j] = myMod(lo[j] + myModMult(w[c], bias_entry(Y, B,
+                                        n, p, batches, rho, rho_sum,
+                                        base + j)));
+                        hi[j] = myMod(hi[j] + myModMult(w[c], bias_entry(Y, B,
+                                        n, p, batches, rho, rho_sum,
+                                        base + h + j)));
+                    }
+                }
+                for (uint64 j = 0; j < len; j++)
+                {
+                    uint64 a0 = split_eq_at(&eq, j0 + j);
+                    uint64 a1 = split_eq_at(&eq, j0 + j + h);
+                    temp0.addmul(a0, lo[j]);
+                    temp1.addmul(a1, hi[j]);
+                    cross.addmul(myMod(2*a1 + 2*PRIME - a0),
+                                 myMod(2*hi[j] + 2*PRIME - lo[j]));
+                }
+            }
+            partial[3*id] = myMod(partial[3*id] + temp0.value().v);
+            partial[3*id+1] = myMod(partial[3*id+1] + temp1.value().v);
+            partial[3*id+2] = myMod(partial[3*id+2] + cross.value().v);
+        });
+        stats_end(&s);
+
+        uint64* Fi = F + 3*i;
+        for (int k = 0; k < 3; k++)
+        {
+            Fp61Acc sum;
+            for (int t = 0; t < nthreads; t++)
+                sum.add(partial[3*t+k]);
+            Fi[k] = sum.value().canonical();
+        }
+        transcript_absorb(tr, Fi, 3);
+        r[d-1-i] = transcript_challenge(tr);
+        scale = myModMult(scale, eq_var(q[d-1-i], r[d-1-i]));
+        arena_release(mem, mark);
+    }
+    arena_sequential(Y, batches*n*sizeof(uint64), false);
+
+    // the remaining rounds, as in check_bias_layer
+    for (; i < d; i++, size >>= 1)
+    {
+        uint64 h = size/2;
+        uint64 sums[3];
+        uint64* Fi = F + 3*i;
+        stat_scope s;
+        stats_begin(&s, "sums", NULL);
+        round_sums_parallel(I, I + h, S, S + h, h, sums, mem);
+        stats_end(&s);
+        for (int k = 0; k < 3; k++)
+            Fi[k] = Fp61(sums[k]).canonical();
+        transcript_absorb(tr, Fi, 3);
+        r[d-1-i] = transcript_challenge(tr);
+
+        stats_begin(&s, "fold", NULL);
+        fold_parallel(I, I, I + h, h, r[d-1-i]);
+        fold_parallel(S, S, S + h, h, r[d-1-i]);
+        stats_end(&s);
+    }
+    uint64 Seval = myModCanon(S[0]);
+    arena_release(mem, base);
+    return Seval;
+}
+
+// entry j of the table of batch t of S = Y + B folded over its low i
+// variables: sum_c w_c S_t(2^i j + c), for the 2^i = blocks weights w
+static inline uint64 sqr_entry(const uint64* Y, const uint64* B, uint64 p,
+        const uint64* w, uint64 blocks, uint64 j)
+{
+    uint64 base = j*blocks;
+    uint64 s = 0;
+    for (uint64 c = 0; c < blocks; c++)
+    {
+        uint64 v = Y[base + c];
+        if (B)
+            v = myMod(v + B[(base + c) & (p-1)]);
+        s = myMod(s + myModMult(w[c], v));
+    }
+    return s;
+}
+
+// sums the partial round sums of the threads, one row of 4 per thread, into
+// the 4 sums of the round
+static void sqr_partial_sums(const uint64* partial, int nthreads,
+        uint64* sums)
+{
+    for (int m = 0; m < 4; m++)
+    {
+        Fp61Acc sum;
+        for (int t = 0; t < nthreads; t++)
+            sum.add(partial[4*t+m]);
+        sums[m] = sum.value().canonical();
+    }
+}
+
+/*
+ * sqr_table_sums:
+ *    computes the 4 sums of a round of sqr_rounds (see prover.cc) on the
+ *    tables T: eq(q, x), then the table of every batch, size entries each,
+ *    one after another.
+ *
+ * Params:
+ *    const uint64* T: the tables
+ *    uint64 size: the length of a table
+ *    int batches: the number of batches
+ *    const uint64* rho: the coefficients of the batches (ignored for a
+ *                       single batch)
+ *    uint64* partial: scratch of 4 words per thread of the pool
+ *    uint64* sums: receives the sums of the round at the points 0 to 3
+ *
+ * Returns:
+ *    Nothing.
+ */
+void sqr_table_sums(const uint64* T, uint64 size, int batches,
+        const uint64* rho, uint64* partial, uint64* sums)
+{
+    int nthreads = threadpool_size();
+    uint64 h = size/2;
+    stats_count(8*batches*h, (batches + 1)*size*sizeof(uint64));
+    for (int m = 0; m < 4*nthreads; m++)
+        partial[m] = 0;
+    parallel_for(h, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int id) {
+        Fp61Acc sum[4];
+        for (int t = 0; t < batches; t++)
+        {
+            uint64 s4[4];
+            sqr_sums_kernel(T + 2*b, T + (t+1)*size + 2*b, e - b, s4);
+            for (int m = 0; m < 4; m++)
+                sum[m].add(batches > 1 ? myModMult(s4[m], rho[t]) : s4[m]);
+        }
+        for (int m = 0; m < 4; m++)
+            partial[4*id+m] = myMod(partial[4*id+m] + sum[m].value().v);
+    });
+    sqr_partial_sums(partial, nthreads, sums);
+}
+
+/*
+ * sqr_table_fold:
+ *    folds the low-order variable of the tables T of sqr_table_sums with
+ *    the challenge r, into the tables U of size/2 entries each.
+ */
+void sqr_table_fold(const uint64* T, uint64 size, int batches, uint64 r,
+        uint64* U)
+{
+    uint64 h = size/2;
+    stats_count((batches + 1)*h, 3*(batches + 1)*h*sizeof(uint64));
+    parallel_for(h, PARALLEL_GRAIN, [&](uint64 b, uint64 e, int) {
+        for (int t = 0; t <= batches; t++)
+            for (uint64 k = b; k < e; k++)
+            {
+                uint64 a = T[t*size + 2*k];
+                uint64 c = T[t*size + 2*k+1];
+                U[t*h + k] = myMod(a + myModMult(r, myMod(c + 2*PRIME - a)));
+            }
+    });
+}
+
+// absorbs the sums of a round as its polynomial Fi and returns the
+// challenge of the round
+static uint64 sqr_round_end(const uint64* sums, uint64* Fi, transcript* tr)
+{
+    for (int m = 0; m < 4; m++)
+        Fi[m] = sums[m];
+    transcript_absorb(tr, Fi, 4);
+    return transcript_challenge(tr);
+}
+
+/*
+ * stream_sqr_bytes:
+ *    returns the least arena footprint of stream_sqr_rounds on d variables
+ *    and batches batches: with it, the tables are materialized halfway
+ *    through the rounds at the latest.
+ */
+size_t stream_sqr_bytes(int d, int batches)
+{
+    int half = (d + 1)/2;
+    uint64 size = (uint64)1 << (d - half);
+    return arena_words_bytes(4*threadpool_size()) +
+           arena_words_bytes(2*STREAM_CHUNK*threadpool_size()) +
+           arena_words_bytes((uint64)1 << half) + split_eq_bytes(d) +
+           arena_words_bytes((batches + 1)*size) +
+           arena_words_bytes((batches + 1)*(size/2));
+}
+
+/*
+ * stream_sqr_rounds:
+ *    sqr_rounds (see prover.cc) without holding the tables of S = Y + B or
+ *    eq(q, x) in memory. Variables are bound low-order first, so after i
+ *    rounds entry j of the folded table of a batch is
+ *    sum_c w_c S(2^i j + c), and a round reads the 2^(i+1) consecutive
+ *    entries of Y of every pair of its table. Once materialized, the tables
+ *    of eq(q, x) and of the batches sit one after another in a buffer, and
+ *    every round folds them into a second one.
+ *
+ * Params:
+ *    uint64* q: the point of the claim, d coordinates
+ *    uint64* r: receives the d challenges
+ *    int d: the number of variables
+ *    uint64 n: 2^d
+ *    int batches: the number of batches
+ *    const uint64* Y: the tables of the batches, n entries each
+ *    const uint64* B: the bias of p entries, or NULL
+ *    uint64 p: the length of a row of Y
+ *    const uint64* rho: the coefficients of the batches (ignored for a
+ *                       single batch)
+ *    uint64* F: receives the d round polynomials, 4 evaluations each
+ *    uint64* finals: receives the S_b~(r)
+ *    transcript* tr: the transcript the challenges are drawn from
+ *    arena* mem: the arena the tables are allocated from
+ *
+ * Returns:
+ *    Nothing.
+ */
+void stream_sqr_rounds(uint64* q, uint64* r, int d, uint64 n, int batches,
+        const uint64* Y, const uint64* B, uint64 p, const uint64* rho,
+        uint64* F, uint64* finals, transcript* tr, arena* mem)
+{
+    int nthreads = threadpool_size();
+    uint64* partial = arena_words(mem, 4*nthreads);
+    uint64* buffers = arena_words(mem, 2*STREAM_CHUNK*nthreads);
+    arena_sequential(Y, batches*n*sizeof(uint64), true);
+
+    // eq(q, r) over the bound variables
+    uint64 scale = 1;
+    uint64* T = NULL;
+    uint64 size = n;
+    int i = 0;
+    for (; i < d; i++, size >>= 1)
+    {
+        size_t mark = arena_mark(mem);
+        uint64 blocks = (uint64)1 << i;
+        uint64* w = arena_words(mem, blocks);
+        eq_table(r, i, w);
+        split_eq eq;
+        split_eq_init(&eq, q + i, d - i, scale, mem);
+        uint64 grain = PARALLEL_GRAIN/blocks + 1;
+        stat_scope s;
+
+        if (arena_words_bytes((batches + 1)*size) +
+                arena_words_bytes((batches + 1)*(size/2)) <=
+                mem->size - arena_mark(mem) || size == 2)
+        {
+            stats_begin(&s, "materialize", NULL);
+            stats_count(batches*n + size,
+                    (batches*n + (batches + 1)*size)*sizeof(uint64));
+            T = arena_words(mem, (batches + 1)*size);
+            parallel_for(size, grain, [&](uint64 b, uint64 e, int) {
+                for (uint64 j = b; j < e; j++)
+                {
+                    T[j] = split_eq_at(&eq, j);
+                    for (int t = 0; t < batches; t++)
+                        T[(t+1)*size + j] = sqr_entry(Y + t*n, B, p, w,
+                                blocks, j);
+                }
+            });
+            stats_end(&s);
+            break;
+        }
+
+        stats_begin(&s, "pass", NULL);
+        stats_count(batches*n + size/2*(batches*(batches > 1 ? 8 : 4) + 6),
+                batches*n*sizeof(uint64));
+        for (int m = 0; m < 4*nthreads; m++)
+            partial[m] = 0;
+        parallel_for(size/2, grain, [&](uint64 b, uint64 e, int id) {
+            // the entries of eq(q, x) and of the table of a batch over the
+            // pairs of a chunk
+            uint64* I = buffers + 2*STREAM_CHUNK*id;
+            uint64* V = I + STREAM_CHUNK;
+            Fp61Acc sum[4];
+            for (uint64 k0 = b; k0 < e; k0 += STREAM_CHUNK/2)
+            {
+                uint64 len = (e - k0 < STREAM_CHUNK/2) ? e - k0 :
+                                                         STREAM_CHUNK/2;
+                for (uint64 j = 0; j < 2*len; j++)
+                    I[j] = split_eq_at(&eq, 2*k0 + j);
+                for (int t = 0; t < batches; t++)
+                {
+                    for (uint64 j = 0; j < 2*len; j++)
+                        V[j] = sqr_entry(Y + t*n, B, p, w, blocks, 2*k0 + j);
+                    uint64 s4[4];
+                    sqr_sums_kernel(I, V, len, s4);
+                    for (int m = 0; m < 4; m++)
+                        sum[m].add(batches > 1 ? myModMult(s4[m], rho[t]) :
+                                                 s4[m]);
+                }
+            }
+            for (int m = 0; m < 4; m++)
+                partial[4*id+m] = myMod(partial[4*id+m] + sum[m].value().v);
+        });
+        stats_end(&s);
+
+        uint64 sums[4];
+        sqr_partial_sums(partial, nthreads, sums);
+        r[i] = sqr_round_end(sums, F + 4*i, tr);
+        scale = myModMult(scale, eq_var(q[i], r[i]));
+        arena_release(mem, mark);
+    }
+    arena_sequential(Y, batches*n*sizeof(uint64), false);
+
+    // the remaining rounds: the sums of a round, then the fold of all the
+    // tables with its challenge into the other buffer
+    uint64* U = arena_words(mem, (batches + 1)*(size/2));
+    for (; i < d; i++, size >>= 1)
+    {
+        uint64 sums[4];
+        stat_scope s;
+        stats_begin(&s, "sums", NULL);
+        sqr_table_sums(T, size, batches, rho, partial, sums);
+        stats_end(&s);
+        r[i] = sqr_round_end(sums, F + 4*i, tr);
+
+        stats_begin(&s, "fold", NULL);
+        sqr_table_fold(T, size, batches, r[i], U);
+        stats_end(&s);
+        uint64* next = U;
+        U = T;
+        T = next;
+    }
+
+    for (int t = 0; t < batches; t++)
+        finals[t] = myModCanon(T[t+1]);
+}
@@ -0,0 +1,32 @@
+/*
+ * stream module header file
+ *
+ * This module contains the out-of-core sum-checks of the prover's bias and
+ * square activation stages, for layers whose tables do not fit in the
+ * memory the prover is given, and the rounds of the square activation on
+ * tables in memory they end with.
+ */
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <cstddef>
+
+#include "arena.h"
+#include "math.h"
+#include "transcript.h"
+
+/* for information on these functions, read stream.cc */
+size_t stream_bias_bytes(int d);
+size_t stream_sqr_bytes(int d, int batches);
+uint64 stream_bias_rounds(uint64* q, uint64* r, int d, uint64 n, uint64 p,
+        int batches, const uint64* Y, const uint64* B, const uint64* rho,
+        uint64 rho_sum, uint64* F, transcript* tr, arena* mem);
+void sqr_table_sums(const uint64* T, uint64 size, int batches,
+        const uint64* rho, uint64* partial, uint64* sums);
+void sqr_table_fold(const uint64* T, uint64 size, int batches, uint64 r,
+        uint64* U);
+void stream_sqr_rounds(uint64* q, uint64* r, int d, uint64 n, int batches,
+        const uint64* Y, const uint64* B, uint64 p, const uint64* rho,
+        uint64* F, uint64* finals, transcript* tr, arena* mem);
+
+#endif // STREAM_H
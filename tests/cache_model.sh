@@ -0,0 +1,42 @@
+#!/bin/sh
+# cache_model:
+#    checks that a private-coin proof is only accepted with a cache built from
+#    the model the verifier is given: a cache of the default network is used
+#    with a model whose first bias entry differs, then with the right one.
+#    Run from the top of the tree, after make (see make check).
+set -e
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+printf '16\n30\n20\n20\n10\n' > "$dir/arch.txt"
+
+./verify.o -w "$dir/model.bin" "$dir/arch.txt" > /dev/null
+./verify.o -m "$dir/model.bin" -c "$dir/cache.bin" "$dir/arch.txt" > /dev/null
+
+# the first bias of the first layer (tensor 2, see model.h) is set to 1
+cp "$dir/model.bin" "$dir/other.bin"
+L=$(od -An -tu8 -j8 -N8 "$dir/model.bin" | tr -d ' ')
+offset=$(od -An -tu8 -j$((8*(8 + 8*L))) -N8 "$dir/model.bin" | tr -d ' ')
+printf '\001\000\000\000\000\000\000\000' |
+    dd of="$dir/other.bin" bs=1 seek="$offset" conv=notrunc 2> /dev/null
+
+# prove streams a private-coin proof of the default network to a verifier
+# of the model $1, and returns the verifier's status
+prove() {
+    ./verify.o -m "$dir/$1" -c "$dir/cache.bin" -u "$dir/sock" \
+        "$dir/arch.txt" > "$dir/verify.txt" &
+    pid=$!
+    ./safetynets.o -i -m "$dir/model.bin" -u "$dir/sock" "$dir/arch.txt" \
+        > /dev/null || true
+    wait $pid
+}
+
+if prove other.bin || ! grep -q "another model" "$dir/verify.txt"; then
+    echo "cache_model: a cache of another model was accepted"
+    exit 1
+fi
+if ! prove model.bin; then
+    echo "cache_model: the proof was rejected with the cache of its model"
+    cat "$dir/verify.txt"
+    exit 1
+fi
+echo "cache_model: ok"
@@ -0,0 +1,167 @@
+/*
+ * threadpool module
+ *
+ * This module contains a persistent pool of worker threads. The workers are
+ * started once by threadpool_init and then sleep on a condition variable
+ * between jobs, so the per-round parallel loops of the sum-check pay a
+ * wake-up rather than a thread spawn.
+ *
+ * A job is a range [0, n) cut into chunks of at least grain iterations;
+ * the caller and the workers claim chunks from a shared counter until the
+ * range is exhausted. The body receives its chunk and the id of the thread
+ * running it (0 for the caller, < threadpool_size()), which callers use to
+ * index per-thread partial results.
+ */
+#include "threadpool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static std::vector<std::thread> workers;
+static std::mutex pool_mutex;
+static std::condition_variable work_cv;
+static std::condition_variable done_cv;
+static uint64 generation = 0;
+static int pending = 0;
+static bool stopping = false;
+
+// the job currently being run
+static const std::function<void(uint64, uint64, int)>* job_body;
+static uint64 job_n;
+static uint64 job_chunk;
+static std::atomic<uint64> job_next;
+
+// set in pool threads and while the caller runs a job, so that nested
+// parallel_for calls fall back to serial execution
+static thread_local bool in_job = false;
+
+/*
+ * run_chunks:
+ *    claims and runs chunks of the current job until none are left.
+ */
+static void run_chunks(int id)
+{
+    uint64 begin;
+    while ((begin = job_next.fetch_add(job_chunk)) < job_n)
+    {
+        uint64 end = (begin + job_chunk < job_n) ? begin + job_chunk : job_n;
+        (*job_body)(begin, end, id);
+    }
+}
+
+static void worker_loop(int id)
+{
+    in_job = true;
+    uint64 seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            work_cv.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        run_chunks(id);
+
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (--pending == 0)
+            done_cv.notify_one();
+    }
+}
+
+/*
+ * threadpool_init:
+ *    starts nthreads-1 workers; the calling thread is the remaining one.
+ *
+ * Params:
+ *    int nthreads: the total number of threads to run jobs on
+ *
+ * Returns:
+ *    Nothing.
+ */
+void threadpool_init(int nthreads)
+{
+    threadpool_shutdown();
+    stopping = false;
+    for (int t = 1; t < nthreads; t++)
+        workers.push_back(std::thread(worker_loop, t));
+}
+
+/*
+ * threadpool_shutdown:
+ *    stops and joins the workers. Safe to call on a stopped pool.
+ */
+void threadpool_shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+    workers.clear();
+}
+
+/*
+ * threadpool_size:
+ *    returns the number of threads jobs run on, including the caller.
+ */
+int threadpool_size()
+{
+    return workers.size() + 1;
+}
+
+/*
+ * parallel_for:
+ *    runs body over [0, n), split into chunks of at least grain iterations,
+ *    on the pool. Returns once every chunk is done. Runs serially on the
+ *    caller when the range is a single chunk, the pool has no workers, or
+ *    it is called from inside another parallel_for.
+ *
+ * Params:
+ *    uint64 n: the length of the range
+ *    uint64 grain: the minimum chunk length
+ *    body: called as body(begin, end, thread id) for every chunk
+ *
+ * Returns:
+ *    Nothing.
+ */
+void parallel_for(uint64 n, uint64 grain,
+        const std::function<void(uint64, uint64, int)>& body)
+{
+    if (n <= grain || workers.empty() || in_job)
+    {
+        if (n > 0)
+            body(0, n, 0);
+        return;
+    }
+
+    // a few chunks per thread so uneven chunks even out
+    uint64 chunk = n/(4*threadpool_size());
+    if (chunk < grain)
+        chunk = grain;
+
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        job_body = &body;
+        job_n = n;
+        job_chunk = chunk;
+        job_next = 0;
+        pending = workers.size();
+        generation++;
+    }
+    work_cv.notify_all();
+
+    in_job = true;
+    run_chunks(0);
+    in_job = false;
+
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    done_cv.wait(lock, [] { return pending == 0; });
+}
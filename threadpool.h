@@ -0,0 +1,25 @@
+/*
+ * threadpool module header file
+ *
+ * This module contains the persistent pool of worker threads that the
+ * prover's data-parallel loops (matrix multiplication, sum-check rounds,
+ * folds and MLE evaluations) are split across.
+ */
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <functional>
+
+#include "math.h"
+
+// ranges shorter than this are run serially by the caller
+#define PARALLEL_GRAIN 4096
+
+/* for information on these functions, read threadpool.cc */
+void threadpool_init(int nthreads);
+void threadpool_shutdown();
+int threadpool_size();
+void parallel_for(uint64 n, uint64 grain,
+        const std::function<void(uint64, uint64, int)>& body);
+
+#endif // THREADPOOL_H
@@ -0,0 +1,128 @@
+/*
+ * transcript module
+ *
+ * This module contains the Fiat-Shamir transcript. It keeps a running
+ * SHA-256 of every message; a challenge is the digest of the messages so
+ * far, which is then absorbed itself so that consecutive challenges differ.
+ * The coins of a private-coin proof are absorbed in place of the digests,
+ * which the prover sends the verifier instead (see channel.cc).
+ */
+#include <cstring>
+
+#include "transcript.h"
+
+/*
+ * transcript_init:
+ *    starts a transcript, bound to the protocol by label.
+ *
+ * Params:
+ *    transcript* tr: the transcript
+ *    const char* label: the name of the protocol
+ *
+ * Returns:
+ *    Nothing.
+ */
+void transcript_init(transcript* tr, const char* label)
+{
+    sha256_init(&tr->ctx);
+    sha256_update(&tr->ctx, label, strlen(label));
+    tr->coins = NULL;
+    tr->used = 0;
+    tr->dealer = NULL;
+    tr->peer = -1;
+    tr->mismatch = false;
+}
+
+/*
+ * transcript_use_coins:
+ *    makes the challenges of the verifier's transcript tr the given coins,
+ *    in order, instead of hashes of the messages. The digest the prover
+ *    sent before each coin (see dealer_digest) must match tr's own, or
+ *    mismatch is set.
+ */
+void transcript_use_coins(transcript* tr, const uint64* coins,
+        coin_dealer* dealer)
+{
+    tr->coins = coins;
+    tr->used = 0;
+    tr->dealer = dealer;
+}
+
+/*
+ * transcript_use_peer:
+ *    makes the challenges of the prover's transcript tr the coins the
+ *    verifier answers its digests with on the coin channel peer.
+ */
+void transcript_use_peer(transcript* tr, int peer)
+{
+    tr->peer = peer;
+}
+
+/*
+ * transcript_absorb:
+ *    appends n words to the transcript. Field elements must be absorbed in
+ *    canonical form, as both sides have to hash the same bytes.
+ *
+ * Params:
+ *    transcript* tr: the transcript
+ *    const uint64* words: the message
+ *    uint64 n: the number of words of the message
+ *
+ * Returns:
+ *    Nothing.
+ */
+void transcript_absorb(transcript* tr, const uint64* words, uint64 n)
+{
+    uint64 len = n;
+    sha256_update(&tr->ctx, &len, sizeof(len));
+    sha256_update(&tr->ctx, words, n*sizeof(uint64));
+}
+
+/*
+ * transcript_challenge:
+ *    derives a challenge in F_p from the messages absorbed so far, or
+ *    returns the next coin of a private-coin transcript.
+ *
+ * Params:
+ *    transcript* tr: the transcript
+ *
+ * Returns:
+ *    uint64: the challenge, canonical.
+ */
+uint64 transcript_challenge(transcript* tr)
+{
+    sha256_ctx fork = tr->ctx;
+    unsigned char digest[SHA256_DIGEST_BYTES];
+    sha256_final(&fork, digest);
+
+    uint64 c;
+    if (tr->coins || tr->peer >= 0)
+    {
+        if (tr->peer >= 0)
+            c = channel_coin(tr->peer, digest);
+        else
+        {
+            unsigned char sent[SHA256_DIGEST_BYTES];
+            if (!dealer_digest(tr->dealer, tr->used, sent) ||
+                memcmp(sent, digest, sizeof(digest)) != 0)
+                tr->mismatch = true;
+            c = tr->coins[tr->used++];
+        }
+        sha256_update(&tr->ctx, &c, sizeof(c));
+        return c;
+    }
+
+    sha256_update(&tr->ctx, digest, sizeof(digest));
+    memcpy(&c, digest, sizeof(c));
+    return myModCanon(c & PRIME);
+}
+
+/*
+ * transcript_challenges:
+ *    derives n challenges into out.
+ */
+void transcript_challenges(transcript* tr, uint64* out, int n)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = transcript_challenge(tr);
+}
@@ -0,0 +1,37 @@
+/*
+ * transcript module header file
+ *
+ * This module contains the Fiat-Shamir transcript that makes the protocol
+ * non-interactive: the prover and the verifier absorb the same messages and
+ * derive every challenge from the hash of the messages before it.
+ */
+#ifndef TRANSCRIPT_H
+#define TRANSCRIPT_H
+
+#include "channel.h"
+#include "math.h"
+#include "sha256.h"
+
+// in a private-coin proof the challenges are the coins the verifier drew
+// ahead of time (see cache.h) instead: the verifier's transcript takes them
+// from coins and checks the prover's digests of dealer against its own, and
+// the prover's transcript asks for them on the coin channel peer
+struct transcript {
+    sha256_ctx ctx;
+    const uint64* coins;
+    uint64 used;
+    coin_dealer* dealer;
+    int peer;
+    bool mismatch;      // a digest of the prover differed from ours
+};
+
+/* for information on these functions, read transcript.cc */
+void transcript_init(transcript* tr, const char* label);
+void transcript_use_coins(transcript* tr, const uint64* coins,
+        coin_dealer* dealer);
+void transcript_use_peer(transcript* tr, int peer);
+void transcript_absorb(transcript* tr, const uint64* words, uint64 n);
+uint64 transcript_challenge(transcript* tr);
+void transcript_challenges(transcript* tr, uint64* out, int n);
+
+#endif // TRANSCRIPT_H
@@ -24,6 +24,42 @@ runtime set_time(runtime t, double ut, double pt, double vt)
     return t;
 }
 
+/*
+ * wall_time:
+ *    returns a monotonic wall-clock time stamp in seconds. Unlike clock(),
+ *    this does not add up the time of every thread, so it is the right
+ *    measure for multithreaded stages.
+ */
+double wall_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+/*
+ * log_size:
+ *    returns the number of variables of size, rounded up to a power of two.
+ */
+static int log_size(int size)
+{
+    return ceil(log2(size));
+}
+
+/*
+ * read_architecture_from_file:
+ *    reads the architecture file at filename: the batch size, the input
+ *    (a size, or channels, height and width for a convolutional network),
+ *    then one line per layer, the number of neurons of a fully connected
+ *    layer or "conv <channels> <kernel size>" for a convolutional one. Every
+ *    layer is returned as LAYER_SHAPE_WORDS ints (see layer_shape): e, d, f,
+ *    the true input and output sizes, the kernel size (0 for a fully
+ *    connected layer) and the log height and width of its maps.
+ *
+ * Returns:
+ *    vector<int*>: the layers. Exits if a convolutional layer has no
+ *    spatial input or its maps are not powers of two.
+ */
 vector <int*> read_architecture_from_file(const char* filename)
 {
 
@@ -38,23 +74,59 @@ vector <int*> read_architecture_from_file(const char* filename)
     stringstream(line) >> batch;
     batch = ceil(log2(batch));
 
-    // read input size
-    double prevl, currl;
+    // read input size; channels, height and width are kept for convolutional
+    // layers, until a fully connected layer flattens the maps
+    int prev_size, height = 0, width = 0;
     getline(archfile, line);
-    stringstream(line) >> prevl;
-    prevl = ceil(log2(prevl));
+    stringstream input(line);
+    input >> prev_size;
+    if (input >> height >> width)
+        prev_size = prev_size*height*width;
+    else
+        height = width = 0;
+    int prev_channels = height ? prev_size/(height*width) : 0;
 
-    // read layer sizes
+    // read layer sizes; the protocol works on the sizes rounded up to powers
+    // of two, the true sizes tell the zero padding apart
     while (getline(archfile, line))
     {
-        stringstream(line) >> currl;
-        currl = ceil(log2(currl));
-        int *n = new int[3];
+        stringstream layer_line(line);
+        string kind;
+        if (!(layer_line >> kind))
+            continue;
+        int *n = new int[8];
         n[0] = batch;
-        n[1] = prevl;
-        n[2] = currl;
+        n[3] = prev_size;
+        n[5] = n[6] = n[7] = 0;
+        if (kind == "conv")
+        {
+            int channels, kernel;
+            layer_line >> channels >> kernel;
+            if (!height || channels < 1 || kernel < 1)
+                cout << "A convolutional layer needs channels, a kernel size"
+                     << " and maps as input" << endl, exit(1);
+            if ((height & (height-1)) || (width & (width-1)))
+                cout << "The maps of a convolutional layer must be powers of"
+                     << " two" << endl, exit(1);
+            n[5] = kernel;
+            n[6] = log_size(height);
+            n[7] = log_size(width);
+            n[1] = log_size(prev_channels) + n[6] + n[7];
+            n[2] = log_size(channels) + n[6] + n[7];
+            n[4] = channels*height*width;
+            prev_channels = channels;
+        }
+        else
+        {
+            int curr_size = atoi(kind.c_str());
+            n[1] = log_size(prev_channels ? prev_channels : prev_size) +
+                   (height ? log_size(height) + log_size(width) : 0);
+            n[2] = log_size(curr_size);
+            n[4] = curr_size;
+            height = width = prev_channels = 0;
+        }
         layers.push_back(n);
-        prevl = currl;
+        prev_size = n[4];
     }
     archfile.close();
 
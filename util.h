@@ -22,6 +22,7 @@ struct runtime {
 
 runtime update_time(runtime t, runtime nt);
 runtime set_time(runtime t, double ut, double pt, double vt);
+double wall_time();
 
 vector <int*> read_architecture_from_file(const char* filename);
 
@@ -0,0 +1,653 @@
+/*
+ * verifier module
+ *
+ * This module contains the verifier's side of the protocol. It reads the
+ * proof record by record, in the order the prover wrote it: the header, the
+ * output of the network, then one record per stage from the output layer
+ * down. Every round polynomial is absorbed into the transcript before the
+ * challenge of its round is derived, exactly as the prover did, so the
+ * challenges of both sides agree. A failed check prints its reason and
+ * rejects the proof: the stages return false, and so does verify_network.
+ */
+#include "verifier.h"
+#include "conv.h"
+#include "mle.h"
+#include "poly.h"
+#include "cache.h"
+#include "stats.h"
+
+using namespace std;
+
+/*
+ * read_stage:
+ *    reads the record of a stage, whose words must all be canonical field
+ *    elements.
+ */
+static bool read_stage(proof_stream* ps, uint32_t type, uint64* words,
+        uint64 count)
+{
+    if (!proof_read(ps, type, words, count))
+        return false;
+    for (uint64 k = 0; k < count; k++)
+        if (words[k] >= PRIME)
+            return cout << "malformed proof record of type " << type << endl,
+                   false;
+    return true;
+}
+
+/*
+ * check_rounds:
+ *    checks the d round polynomials of a sum-check of the claim a1, given by
+ *    their evaluations at 0..evals-1, and draws their challenges.
+ *
+ * Params:
+ *    const char* name: the name of the layer, for the error messages
+ *    uint64 a1: the claimed sum
+ *    uint64* F: the round polynomials, evals words each
+ *    int d: the number of rounds
+ *    int evals: the number of evaluations of each polynomial
+ *    transcript* tr: the transcript
+ *    uint64* r: receives the challenges
+ *    bool high_first: the variables are bound high-order first, round i
+ *                     drawing r[d-1-i] (otherwise r[i])
+ *    uint64* last: receives the last round polynomial at its challenge,
+ *                  which the stage checks against its inputs
+ *
+ * Returns:
+ *    bool: false if a round fails its check.
+ */
+static bool check_rounds(const char* name, uint64 a1, uint64* F, int d,
+        int evals, transcript* tr, uint64* r, bool high_first, uint64* last)
+{
+    uint64 expected = a1;
+    for (int i=0; i<d; i++)
+    {
+        uint64* Fi = F + evals*i;
+        if (Fp61(Fi[0]) + Fi[1] != Fp61(expected))
+        {
+            if (i == 0)
+                return cout << name << " first check failed" << endl, false;
+            return cout << name << " check " << i << " failed" << endl, false;
+        }
+        transcript_absorb(tr, Fi, evals);
+        uint64 ri = transcript_challenge(tr);
+        r[high_first ? d-1-i : i] = ri;
+        expected = extrap(Fi, evals, ri);
+    }
+    *last = expected;
+    return true;
+}
+
+/*
+ * verifier_footprint:
+ *    returns the arena footprint of verify_network on a network of
+ *    architecture arch.
+ */
+size_t verifier_footprint(vector<int*>& arch, int batches)
+{
+    int L = arch.size();
+    size_t stage = 0;
+    int max_vars = 0;
+    for (int i=0; i<L; i++)
+    {
+        int e = arch[i][0];
+        int d = arch[i][1];
+        int f = arch[i][2];
+        max_vars = max(max_vars, e + max(d, f));
+        int k = arch[i][5];
+        int hw = arch[i][6] + arch[i][7];
+        int kd = k ? conv_weight_vars(d, k, arch[i][6], arch[i][7]) : d;
+        // the evaluations of the weights, bias and input of the layer
+        size_t mle = max(mle_scratch_bytes(k ? f - hw : f, kd, 1),
+                max(mle_scratch_bytes(e, d, batches),
+                    mle_scratch_bytes(0, f, 1)));
+        stage = max(stage, 2*arena_words_bytes(f+d+e) +
+                arena_words_bytes(4*(e+max(d, f)) + batches) +
+                arena_words_bytes(batches) + mle);
+        if (k)
+            stage = max(stage, arena_words_bytes(3*kd + 1 + 3*(e+d) + 1) +
+                    arena_words_bytes(kd + f) + arena_words_bytes(e+d) +
+                    conv_tables_bytes(e, d, k, arch[i][6], arch[i][7]) +
+                    arena_words_bytes(batches) + mle);
+    }
+    int e = arch[L-1][0];
+    int f = arch[L-1][2];
+    uint64 out_words = batches*myPow(2, e + f);
+    return max(stage, mle_scratch_bytes(e, f, batches)) +
+           arena_words_bytes(out_words) + arena_words_bytes(MODEL_DIGEST_WORDS) +
+           arena_words_bytes(max_vars) + 2*arena_words_bytes(batches);
+}
+
+/*
+ * read_header:
+ *    reads the header record of a proof into header and checks that it is
+ *    about the architecture arch.
+ *
+ * Returns:
+ *    bool: false if the header cannot be read or the proof is about another
+ *          network.
+ */
+bool read_header(proof_stream* ps, vector<int*>& arch, uint64* header)
+{
+    int L = arch.size();
+    if (!proof_read(ps, PROOF_HEADER, header, PROOF_HEADER_WORDS(L)))
+        return false;
+    if (header[0] != PROOF_MAGIC || header[1] != L || header[2] < 1)
+        return cout << "the proof is not about this network" << endl, false;
+    for (int i = 0; i < L; i++)
+        for (int k = 0; k < LAYER_SHAPE_WORDS; k++)
+            if (header[5 + LAYER_SHAPE_WORDS*i + k] != arch[i][k])
+                return cout << "the proof is not about this network" << endl,
+                       false;
+    return true;
+}
+
+/*
+ * verify_bias:
+ *    checks the claim c about the output S = Y + b of the bias of layer l
+ *    and reduces it to the prover's claim about Y, which replaces it. The
+ *    evaluation of the bias is taken from cached[1] when a preprocessing
+ *    cache provides it (cached not NULL). The verifier time of the stage
+ *    goes to time; false is returned if the proof is rejected.
+ */
+bool verify_bias(layer* l, claim* c, transcript* tr, proof_stream* ps,
+        const uint64* cached, arena* mem, runtime* time)
+{
+    int d = l->e + l->f;
+    stat_scope stage, part;
+    stats_begin(&stage, "bias", mem);
+
+    uint64* F = arena_words(mem, 3*d + 1);
+    stats_begin(&part, "read", NULL);
+    if (!read_stage(ps, PROOF_BIAS, F, 3*d + 1))
+        return stats_abort(&stage), false;
+    stats_end(&part);
+
+    uint64* r = arena_words(mem, d);
+
+    stats_begin(&part, "rounds", NULL);
+    uint64 last;
+    if (!check_rounds("bias layer", c->value, F, d, 3, tr, r, true, &last))
+        return stats_abort(&stage), false;
+    stats_end(&part);
+
+    // assertion about the input of this layer returned by the prover (output
+    // of mm mult layer)
+    uint64 Vieval = F[3*d];
+    transcript_absorb(tr, F + 3*d, 1);
+
+    uint64 rho_sum = 0;
+    for (int b=0; b<c->batches; b++)
+        rho_sum = myMod(rho_sum + c->rho[b]);
+
+    stats_begin(&part, "mle", NULL);
+    uint64 Ieval = evaluate_I(c->point, r, d);
+    // the bias only depends on the f column variables
+    uint64 Beval = cached ? cached[1] :
+                            evaluate_V_i(l->f, l->p_true, l->b, r, mem);
+    stats_end(&part);
+
+    //last check
+    uint64 a2 = myModMult(myMod(Vieval + myModMult(rho_sum, Beval)), Ieval);
+    if (Fp61(a2) != Fp61(last))
+        return cout << "bias layer last check failed" << endl,
+               stats_abort(&stage), false;
+
+    double vt = stats_end(&stage);
+    cout << "verifier time for bias = " << vt << endl;
+
+    for (int i=0; i<d; i++)
+        c->point[i] = r[i];
+    c->value = Vieval;
+
+    *time = set_time(*time, 0, 0, vt);
+    return true;
+}
+
+/*
+ * verify_mm:
+ *    checks the claim c about the output Y = X W^T of layer l and reduces it
+ *    to the prover's claim about its input X, which replaces it. The
+ *    verifier evaluates the MLE of the weights itself, or takes it from
+ *    cached[0]; at the first layer (first set) it also checks the new claim
+ *    against the input of the network. As in verify_bias, the time goes to
+ *    time and false is returned if the proof is rejected.
+ */
+bool verify_mm(layer* l, claim* c, bool first, transcript* tr,
+        proof_stream* ps, const uint64* cached, arena* mem, runtime* time)
+{
+    int e = l->e;
+    int d = l->d;
+    int f = l->f;
+    stat_scope stage, part;
+    stats_begin(&stage, "mm", mem);
+
+    uint64* F = arena_words(mem, 3*d + 1);
+    stats_begin(&part, "read", NULL);
+    if (!read_stage(ps, PROOF_MM, F, 3*d + 1))
+        return stats_abort(&stage), false;
+    stats_end(&part);
+
+    uint64* z = arena_zeros(mem, f+d+e);
+    uint64* r = arena_zeros(mem, f+d+e);
+    for(int i = 0; i < f+e; i++)
+        r[d+i] = c->point[i];
+
+    stats_begin(&part, "rounds", NULL);
+    uint64 last;
+    if (!check_rounds("matrix-matrix mult layer", c->value, F, d, 3, tr, r,
+            true, &last))
+        return stats_abort(&stage), false;
+    stats_end(&part);
+
+    // assertion about the input of this layer returned by the prover (output
+    // of sqr activation layer)
+    uint64 Aeval = F[3*d];
+    transcript_absorb(tr, F + 3*d, 1);
+
+    // Beval corresponds to layer weight (w), which the verifier evaluates
+    // once for all the batches
+    uint64 Beval;
+    stats_begin(&part, "mle", NULL);
+    if (cached)
+        Beval = cached[0];
+    else
+    {
+        const void* W = l->W;
+        evaluate_matrix_multi(f, d, l->p_true, l->n_true, &W, l->Wtype, &r,
+                1, &Beval, mem);
+    }
+    stats_end(&part);
+
+    uint64 a2 = myModMult(Aeval, Beval);
+    if (Fp61(a2) != Fp61(last))
+        return cout  << "matrix-matrix mult layer last check failed" << endl,
+               stats_abort(&stage), false;
+
+    // set the high order of values to be those of corresponding to index i,
+    // and the low order values of z to be those corresponding to index k
+    for(int i = 0; i < d; i++)
+        z[i] = r[i]; //set the low-order values of z
+    for(int i = d; i < d+e; i++)
+        z[i] = r[f+i]; //set the low-order values of z
+
+    // V evaluates the MLE of input for the first layer
+    if (first)
+    {
+        uint64* evals = arena_words(mem, c->batches);
+        stats_begin(&part, "input", NULL);
+        evaluate_matrix_batch(e, d, l->n_true, l->X, l->Xtype, c->batches, z,
+                evals, mem);
+        stats_end(&part);
+        if (Fp61(claim_combine(c, evals)) != Fp61(Aeval))
+            return cout << "input check failed" << endl,
+                   stats_abort(&stage), false;
+    }
+
+    double vt = stats_end(&stage);
+    cout << "verifier time for matrix-matrix mult = " << vt << endl;
+
+    for (int i=0; i<d+e; i++)
+        c->point[i] = z[i];
+    c->value = Aeval;
+
+    *time = set_time(*time, 0, 0, vt);
+    return true;
+}
+
+/*
+ * verify_conv:
+ *    checks the claim c about the output Y of the convolutional layer l and
+ *    reduces it to the prover's claim about its input X, which replaces it
+ *    (see prove_conv). The verifier evaluates the MLE of the kernel, or
+ *    takes it from cached[0], and that of the table G of conv_input_table;
+ *    at the first layer (first set) it also checks the new claim against
+ *    the input of the network.
+ */
+bool verify_conv(layer* l, claim* c, bool first, transcript* tr,
+        proof_stream* ps, const uint64* cached, arena* mem, runtime* time)
+{
+    int e = l->e;
+    int d = l->d;
+    int f = l->f;
+    int kd = conv_weight_vars(d, l->k, l->h, l->w);
+    int hw = l->h + l->w;
+    stat_scope stage, part;
+    stats_begin(&stage, "conv", mem);
+
+    uint64* F = arena_words(mem, 3*kd + 1 + 3*(e+d) + 1);
+    stats_begin(&part, "read", NULL);
+    if (!read_stage(ps, PROOF_CONV, F, 3*kd + 1 + 3*(e+d) + 1))
+        return stats_abort(&stage), false;
+    stats_end(&part);
+    uint64* F_in = F + 3*kd + 1;
+
+    uint64* z = c->point;
+    uint64* r = arena_zeros(mem, kd + f - hw);
+    uint64* q = arena_zeros(mem, e+d);
+
+    stats_begin(&part, "rounds", NULL);
+    uint64 last;
+    if (!check_rounds("convolution layer", c->value, F, kd, 3, tr, r, true,
+            &last))
+        return stats_abort(&stage), false;
+    stats_end(&part);
+    uint64 Aeval = F[3*kd];
+    transcript_absorb(tr, F + 3*kd, 1);
+
+    // the kernel is evaluated at the kernel index r and the output channels
+    // of z, once for all the batches
+    for (int i = 0; i < f - hw; i++)
+        r[kd+i] = z[hw+i];
+    uint64 Beval;
+    stats_begin(&part, "mle", NULL);
+    if (cached)
+        Beval = cached[0];
+    else
+    {
+        const void* W = l->W;
+        evaluate_matrix_multi(f - hw, kd, l->p_true >> hw, myPow(2, kd), &W,
+                l->Wtype, &r, 1, &Beval, mem);
+    }
+    stats_end(&part);
+    if (Fp61(myModMult(Aeval, Beval)) != Fp61(last))
+        return cout << "convolution layer last check failed" << endl,
+               stats_abort(&stage), false;
+
+    // the patches are reduced to the input
+    stats_begin(&part, "rounds", NULL);
+    if (!check_rounds("convolution input", Aeval, F_in, e+d, 3, tr, q, true,
+            &last))
+        return stats_abort(&stage), false;
+    stats_end(&part);
+    uint64 Xeval = F_in[3*(e+d)];
+    transcript_absorb(tr, F_in + 3*(e+d), 1);
+    stats_begin(&part, "mle", NULL);
+    uint64 Geval = conv_input_eval(l, r, z, q, mem);
+    stats_end(&part);
+    if (Fp61(myModMult(Xeval, Geval)) != Fp61(last))
+        return cout << "convolution input last check failed" << endl,
+               stats_abort(&stage), false;
+
+    if (first)
+    {
+        uint64* evals = arena_words(mem, c->batches);
+        stats_begin(&part, "input", NULL);
+        evaluate_matrix_batch(e, d, l->n_true, l->X, l->Xtype, c->batches, q,
+                evals, mem);
+        stats_end(&part);
+        if (Fp61(claim_combine(c, evals)) != Fp61(Xeval))
+            return cout << "input check failed" << endl,
+                   stats_abort(&stage), false;
+    }
+
+    double vt = stats_end(&stage);
+    cout << "verifier time for convolution = " << vt << endl;
+
+    for (int i=0; i<d+e; i++)
+        c->point[i] = q[i];
+    c->value = Xeval;
+
+    *time = set_time(*time, 0, 0, vt);
+    return true;
+}
+
+/*
+ * verify_sqr_stage:
+ *    checks the sum-check of the square activation of layer l on the claim
+ *    c and leaves in evals the prover's claims about the input of the
+ *    activation, one per batch, at the new point. Returns false if the
+ *    proof is rejected.
+ */
+static bool verify_sqr_stage(layer* l, claim* c, const char* name,
+        uint32_t type, transcript* tr, proof_stream* ps, uint64* evals,
+        arena* mem)
+{
+    int d = l->e + l->f;
+    int batches = c->batches;
+
+    stat_scope part;
+    uint64* F = arena_words(mem, 4*d + batches);
+    stats_begin(&part, "read", NULL);
+    if (!read_stage(ps, type, F, 4*d + batches))
+        return false;
+    stats_end(&part);
+
+    uint64* r = arena_words(mem, d);
+
+    stats_begin(&part, "rounds", NULL);
+    uint64 last;
+    if (!check_rounds(name, c->value, F, d, 4, tr, r, false, &last))
+        return false;
+    stats_end(&part);
+
+    // assertions about the input of this layer returned by the prover
+    for (int b=0; b<batches; b++)
+        evals[b] = F[4*d + b];
+    transcript_absorb(tr, F + 4*d, batches);
+
+    stats_begin(&part, "mle", NULL);
+    uint64 Ieval = evaluate_I(c->point, r, d);
+    stats_end(&part);
+
+    //last check
+    Fp61Acc sqr;
+    for (int b=0; b<batches; b++)
+        sqr.addmul(myModMult(evals[b], evals[b]), c->rho[b]);
+    uint64 a2 = myModMult(sqr.value().v, Ieval);
+    if (Fp61(a2) != Fp61(last))
+        return cout << name << " last check failed" << endl, false;
+
+    for (int i=0; i<d; i++)
+        c->point[i] = r[i];
+    return true;
+}
+
+/*
+ * verify_sqr_activation:
+ *    checks the claim c about the output (Y + b)^2 of the activation of
+ *    layer l and reduces it to the prover's claim about S = Y + b, which
+ *    replaces it.
+ */
+bool verify_sqr_activation(layer* l, claim* c, transcript* tr,
+        proof_stream* ps, arena* mem, runtime* time)
+{
+    stat_scope stage;
+    stats_begin(&stage, "sqr", mem);
+    uint64* evals = arena_words(mem, c->batches);
+    if (!verify_sqr_stage(l, c, "square activation layer", PROOF_SQR, tr, ps,
+            evals, mem))
+        return stats_abort(&stage), false;
+    c->value = claim_combine(c, evals);
+    double vt = stats_end(&stage);
+    cout << "verifier time for sqr activation = " << vt << endl;
+
+    *time = set_time(*time, 0, 0, vt);
+    return true;
+}
+
+/*
+ * verify_bias_sqr_activation:
+ *    checks the claim c about the output (Y + b)^2 of the bias and
+ *    activation of layer l and reduces it to a claim about Y, which replaces
+ *    it. As in verify_bias, cached[1] may hold the evaluation of the bias.
+ */
+bool verify_bias_sqr_activation(layer* l, claim* c, transcript* tr,
+        proof_stream* ps, const uint64* cached, arena* mem, runtime* time)
+{
+    stat_scope stage, part;
+    stats_begin(&stage, "bias_sqr", mem);
+    uint64* evals = arena_words(mem, c->batches);
+    if (!verify_sqr_stage(l, c, "bias and sqr activation layer",
+            PROOF_BIAS_SQR, tr, ps, evals, mem))
+        return stats_abort(&stage), false;
+
+    // the prover's claims are about Y + b; the verifier evaluates the bias,
+    // shared by the batches, once
+    uint64 rho_sum = 0;
+    for (int b=0; b<c->batches; b++)
+        rho_sum = myMod(rho_sum + c->rho[b]);
+    stats_begin(&part, "mle", NULL);
+    uint64 Beval = cached ? cached[1] :
+                            evaluate_V_i(l->f, l->p_true, l->b, c->point,
+                                    mem);
+    stats_end(&part);
+    c->value = (Fp61(claim_combine(c, evals)) -
+                Fp61(myModMult(rho_sum, Beval))).canonical();
+    double vt = stats_end(&stage);
+    cout << "verifier time for bias and sqr activation = " << vt << endl;
+
+    *time = set_time(*time, 0, 0, vt);
+    return true;
+}
+
+/*
+ * verify_network:
+ *    checks the proof ps, whose header has been read into header, against
+ *    the network net.
+ *
+ * Params:
+ *    vector<layer>& net: the network: the input of its first layer and the
+ *                        weights and bias of every layer
+ *    const uint64* header: the header of the proof (see read_header)
+ *    const uint64* session: a session of the preprocessing cache (see
+ *                           cache.h) for a private-coin proof, or NULL for
+ *                           a Fiat-Shamir one
+ *    coin_dealer* dealer: the dealer of the coins of session to the prover
+ *                         (see dealer_start), or NULL
+ *    proof_stream* ps: the proof, positioned after the header
+ *    arena* mem: the arena the stages allocate from
+ *    runtime* time: receives the verifier time of all the stages
+ *
+ * Returns:
+ *    bool: true if the proof is accepted. A rejected proof prints its reason
+ *          and returns false.
+ */
+bool verify_network(vector<layer>& net, const uint64* header,
+        const uint64* session, coin_dealer* dealer, proof_stream* ps,
+        arena* mem, runtime* time)
+{
+    int L = net.size();
+    int batches = header[2];
+    bool separate = header[3];
+    // the coins of a private-coin proof are the verifier's own
+    if (header[4] != (session != NULL))
+        return cout << (header[4] ? "the proof is private-coin: it is checked"
+                        " with a session of the verifier's cache" :
+                        "the proof is not private-coin") << endl, false;
+    int max_vars = 0;
+    for (int i=0; i<L; i++)
+        max_vars = max(max_vars, net[i].e + max(net[i].d, net[i].f));
+    layer* last = &net[L-1];
+    int out_vars = last->e + last->f;
+    uint64 out_size = myPow(2, out_vars);
+    stat_scope top, stage;
+    stats_layer(0);
+    stats_begin(&top, "verify", mem);
+    stats_begin(&stage, "output", mem);
+
+    uint64* out = arena_words(mem, batches*out_size);
+    if (!read_stage(ps, PROOF_OUTPUT, out, batches*out_size))
+        return stats_abort(&top), false;
+
+    runtime total_time;
+    total_time = set_time(total_time, 0, 0, 0);
+
+    // the verifier claims the output at a point drawn from the transcript
+    uint64* statement = NULL;
+    if (!session)
+    {
+        statement = arena_words(mem, MODEL_DIGEST_WORDS);
+        model_digest(net, batches, statement);
+    }
+    transcript tr;
+    transcript_init(&tr, "safetynets");
+    if (session)
+        transcript_use_coins(&tr, session, dealer);
+    claim c;
+    claim_init(&c, &tr, header, statement, out, batches*out_size, out_vars,
+            max_vars, batches, mem);
+    // the padding of the output is zero (see struct layer), and only the
+    // rest is evaluated
+    uint64 p = myPow(2, last->f);
+    for (uint64 k=0; k<batches*out_size; k++)
+        if ((k & (p-1)) >= last->p_true && out[k] != 0)
+            return cout << "output padding check failed" << endl,
+                   stats_abort(&top), false;
+    uint64* evals = arena_words(mem, batches);
+    evaluate_matrix_batch(last->e, last->f, last->p_true, out, ELEM_U64,
+            batches, c.point, evals, mem);
+    c.value = claim_combine(&c, evals);
+    double ot = stats_end(&stage);
+    cout << "verifier time for the output claim = " << ot << endl;
+    runtime out_time;
+    total_time = update_time(total_time, set_time(out_time, 0, 0, ot));
+
+    // a session holds the evaluations of the weights and bias of every
+    // layer after its coins, top layer first
+    const uint64* cached = NULL;
+    if (session)
+        cached = session + cache_coins(net, batches, separate);
+
+    // the stages run until one rejects the proof
+    size_t base = arena_mark(mem);
+    bool accepted = true;
+    runtime stage_time;
+    for (int i=L-1; accepted && i>=0; i--)
+    {
+        cout << "======== Layer " << i+1 << " verification =======" << endl;
+        layer* l = &net[i];
+        stats_layer(i+1);
+        const uint64* layer_evals = cached ? cached + 2*(L-1-i) : NULL;
+
+        // no activation in the last layer
+        if (i!=L-1 && !separate)
+        {
+            arena_release(mem, base);
+            accepted = verify_bias_sqr_activation(l, &c, &tr, ps,
+                    layer_evals, mem, &stage_time);
+            if (accepted)
+                total_time = update_time(total_time, stage_time);
+        }
+        else
+        {
+            if (i!=L-1)
+            {
+                arena_release(mem, base);
+                accepted = verify_sqr_activation(l, &c, &tr, ps, mem,
+                        &stage_time);
+                if (accepted)
+                    total_time = update_time(total_time, stage_time);
+            }
+
+            arena_release(mem, base);
+            accepted = accepted &&
+                    verify_bias(l, &c, &tr, ps, layer_evals, mem, &stage_time);
+            if (accepted)
+                total_time = update_time(total_time, stage_time);
+        }
+
+        arena_release(mem, base);
+        accepted = accepted && (l->k ?
+                verify_conv(l, &c, i == 0, &tr, ps, layer_evals, mem,
+                    &stage_time) :
+                verify_mm(l, &c, i == 0, &tr, ps, layer_evals, mem,
+                    &stage_time));
+        if (accepted)
+            total_time = update_time(total_time, stage_time);
+    }
+    accepted = accepted && proof_end(ps);
+    if (accepted && tr.mismatch)
+    {
+        cout << "the prover's transcript differs from the proof" << endl;
+        accepted = false;
+    }
+    arena_release(mem, base);
+    stats_layer(0);
+    if (!accepted)
+        return stats_abort(&top), false;
+    stats_end(&top);
+
+    *time = total_time;
+    return true;
+}
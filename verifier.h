@@ -0,0 +1,38 @@
+/*
+ * verifier module header file
+ *
+ * This module contains the verifier's side of the protocol: it replays the
+ * Fiat-Shamir transcript of a proof, checks the round polynomials of every
+ * stage and evaluates the weights, biases and input of the network itself.
+ */
+#ifndef VERIFIER_H
+#define VERIFIER_H
+
+#include <vector>
+
+#include "arena.h"
+#include "channel.h"
+#include "math.h"
+#include "model.h"
+#include "proof.h"
+#include "transcript.h"
+#include "util.h"
+
+/* for information on these functions, read verifier.cc */
+size_t verifier_footprint(std::vector<int*>& arch, int batches);
+bool read_header(proof_stream* ps, std::vector<int*>& arch, uint64* header);
+bool verify_bias(layer* l, claim* c, transcript* tr, proof_stream* ps,
+        const uint64* cached, arena* mem, runtime* time);
+bool verify_mm(layer* l, claim* c, bool first, transcript* tr,
+        proof_stream* ps, const uint64* cached, arena* mem, runtime* time);
+bool verify_conv(layer* l, claim* c, bool first, transcript* tr,
+        proof_stream* ps, const uint64* cached, arena* mem, runtime* time);
+bool verify_sqr_activation(layer* l, claim* c, transcript* tr,
+        proof_stream* ps, arena* mem, runtime* time);
+bool verify_bias_sqr_activation(layer* l, claim* c, transcript* tr,
+        proof_stream* ps, const uint64* cached, arena* mem, runtime* time);
+bool verify_network(std::vector<layer>& net, const uint64* header,
+        const uint64* session, coin_dealer* dealer, proof_stream* ps,
+        arena* mem, runtime* time);
+
+#endif // VERIFIER_H
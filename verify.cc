@@ -0,0 +1,244 @@
+/* verify:
+ *
+ *  Standalone verifier of the non-interactive SafetyNets proofs written by
+ *  safetynets. It regenerates the network (input, weights and biases) from
+ *  its architecture, then checks a proof file, or a proof streamed by a
+ *  prover over a Unix socket, against it. With -c, it instead preprocesses
+ *  the given number of private-coin sessions into a cache file (see
+ *  cache.h), and with -c and -u checks a private-coin proof streamed by
+ *  safetynets -i, dealing it the coins of the next session of the cache;
+ *  with -w, it writes the network to a model file (see model.h) for -m.
+ *
+ * Licensing:
+ *  This work is licensed under CC BY-NC-SA 3.0. Refer to the licesne file for
+ *  more information.
+ */
+#include "arena.h"
+#include "cache.h"
+#include "channel.h"
+#include "kernels.h"
+#include "math.h"
+#include "model.h"
+#include "proof.h"
+#include "threadpool.h"
+#include "safetynets.h"
+#include "stats.h"
+#include "util.h"
+#include "verifier.h"
+
+using namespace std;
+
+int main(int argc, char** argv)
+{
+    // number of threads the MLE evaluations run on (-t)
+    int num_threads = 1;
+    // Unix socket the proof is streamed in on, instead of a file (-u)
+    const char* socket_path = NULL;
+    // cache file to preprocess sessions sessions into (-c, -P), for proofs
+    // of batches batches (-k), with separate activations or not (-s); with
+    // -u, the cache a streamed private-coin proof takes its session from
+    const char* cache_path = NULL;
+    int sessions = 1;
+    int num_batches = 1;
+    bool separate_activation = false;
+    // model file the network is mapped from (-m), or written to (-w) with
+    // entries of bits bits (-b: 8, 16, or 64 for field elements)
+    const char* model_path = NULL;
+    const char* save_path = NULL;
+    int bits = 64;
+    // file the timings, counters and peak memory of every stage are
+    // written to (-j), as CSV if it ends in .csv and JSON otherwise
+    const char* report_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:u:c:P:k:sm:w:b:j:")) != -1)
+    {
+        if (opt == 't')
+            num_threads = atoi(optarg);
+        else if (opt == 'u')
+            socket_path = optarg;
+        else if (opt == 'c')
+            cache_path = optarg;
+        else if (opt == 'P')
+            sessions = atoi(optarg);
+        else if (opt == 'k')
+            num_batches = atoi(optarg);
+        else if (opt == 's')
+            separate_activation = true;
+        else if (opt == 'm')
+            model_path = optarg;
+        else if (opt == 'w')
+            save_path = optarg;
+        else if (opt == 'b')
+            bits = atoi(optarg);
+        else if (opt == 'j')
+            report_path = optarg;
+        else
+            cout << "Usage: " << argv[0] << " [-t threads] [-j report]"
+                 << " <arch file> <proof file>" << endl
+                 << "       " << argv[0] << " [-t threads] [-j report]"
+                 << " -u socket <arch file>" << endl
+                 << "       " << argv[0] << " [-t threads] -c cache"
+                 << " [-P sessions] [-k batches] [-s] <arch file>" << endl
+                 << "       " << argv[0] << " [-t threads] [-j report]"
+                 << " -c cache -u socket <arch file>" << endl
+                 << "       " << argv[0] << " -w model file [-b bits]"
+                 << " [-k batches] <arch file>" << endl
+                 << "  (-m model file reads the network from a model file)"
+                 << endl, exit(1);
+    }
+    if (optind != argc - (socket_path || cache_path || save_path ? 1 : 2))
+        cout << "Enter the architecture and proof files as arguments."
+             << endl, exit(1);
+    if (num_threads < 1)
+        cout << "The number of threads must be positive." << endl, exit(1);
+    if (sessions < 1 || num_batches < 1)
+        cout << "The number of sessions and batches must be positive."
+             << endl, exit(1);
+    if (bits != 8 && bits != 16 && bits != 64)
+        cout << "Model file entries are 8, 16 or 64 bits." << endl, exit(1);
+
+    threadpool_init(num_threads);
+
+    vector <int*> layers = read_architecture_from_file(argv[optind]);
+    int L = layers.size();
+    model_file mf;
+
+    // the generated network is written out with entries of the given width
+    if (save_path)
+    {
+        arena net_mem;
+        arena_init(&net_mem, model_bytes(layers, num_batches, false, NULL));
+        vector<layer> net;
+        model_init(net, layers, num_batches, false, NULL, &net_mem);
+        model_save(save_path, net, num_batches,
+                bits == 8 ? MODEL_I8 : bits == 16 ? MODEL_I16 : MODEL_U64);
+
+        for (int i=0; i<layers.size(); i++)
+            delete layers[i];
+        arena_destroy(&net_mem);
+        threadpool_shutdown();
+        return 0;
+    }
+
+    // preprocessing reads the weights and biases once for all the sessions
+    if (cache_path && !socket_path)
+    {
+        if (model_path && !model_open(&mf, model_path, layers, num_batches))
+            exit(1);
+        const model_file* model = model_path ? &mf : NULL;
+        arena net_mem;
+        arena_init(&net_mem, model_bytes(layers, num_batches, false, model));
+        vector<layer> net;
+        model_init(net, layers, num_batches, false, model, &net_mem);
+
+        double wt = wall_time();
+        cache_build(cache_path, net, num_batches, separate_activation,
+                sessions);
+        wt = wall_time() - wt;
+        cout << "preprocessed " << sessions << " sessions of "
+             << cache_session_words(net, num_batches, separate_activation)
+                * sizeof(uint64) << " bytes" << endl;
+        cout << "preprocessing wall time = " << wt << endl;
+
+        for (int i=0; i<layers.size(); i++)
+            delete layers[i];
+        arena_destroy(&net_mem);
+        if (model_path)
+            model_close(&mf);
+        threadpool_shutdown();
+        return 0;
+    }
+
+    // a streamed proof is checked stage by stage as its records arrive,
+    // while the prover works on the next ones; the wall time is then the
+    // end-to-end latency from the prover's start
+    proof_stream ps;
+    int listener = socket_path ? channel_listen(socket_path) : -1;
+    if (socket_path)
+        proof_attach(&ps, channel_accept(listener));
+    double wt = wall_time();
+    if (!socket_path)
+        proof_open(&ps, argv[optind+1], false);
+    uint64* header = new uint64[PROOF_HEADER_WORDS(L)];
+    if (!read_header(&ps, layers, header))
+        cout << "proof rejected" << endl, exit(1);
+    int batches = header[2];
+    bool separate = header[3];
+
+    // a private-coin proof is checked against a session of the cache, whose
+    // coins are dealt to the prover on its second connection
+    if (header[4] && !cache_path)
+        cout << "The proof is private-coin: check it with -c cache -u socket."
+             << endl, exit(1);
+    if (!header[4] && cache_path)
+        cout << "The proof is not private-coin." << endl, exit(1);
+    int peer = cache_path ? channel_accept_coins(listener) : -1;
+    if (socket_path)
+        channel_unlisten(listener, socket_path);
+
+    // the verifier only holds the input, the weights and the biases
+    if (model_path && !model_open(&mf, model_path, layers, batches))
+        exit(1);
+    const model_file* model = model_path ? &mf : NULL;
+    arena net_mem;
+    arena_init(&net_mem, model_bytes(layers, batches, false, model));
+    vector<layer> net;
+    model_init(net, layers, batches, false, model, &net_mem);
+
+    // the session is used up before the first coin is dealt
+    vector<uint64> session;
+    coin_dealer dealer;
+    if (cache_path)
+    {
+        session.resize(cache_session_words(net, batches, separate));
+        cache_take(cache_path, net, batches, separate, session.data());
+        dealer_start(&dealer, peer, session.data(),
+                cache_coins(net, batches, separate));
+    }
+
+    arena mem;
+    arena_init(&mem, verifier_footprint(layers, batches));
+    runtime total_time;
+    bool accepted = verify_network(net, header,
+            cache_path ? session.data() : NULL, cache_path ? &dealer : NULL,
+            &ps, &mem, &total_time);
+    if (cache_path)
+        dealer_stop(&dealer);
+    proof_close(&ps);
+    if (!accepted)
+        cout << "proof rejected" << endl, exit(1);
+    wt = wall_time() - wt;
+
+    cout << "proof accepted" << endl;
+    cout << "proof size = " << ps.bytes << " bytes" << endl;
+    cout << "total verifier time = " << total_time.verifier << endl;
+    cout << (socket_path ? "end-to-end wall time = " : "wall time = ") << wt
+         << endl;
+
+    if (report_path)
+    {
+        stats_set_text("arch", argv[optind]);
+        stats_set_text("kernels", kernels_path());
+        stats_set("threads", num_threads);
+        stats_set("batches", batches);
+        stats_set("proof_bytes", ps.bytes);
+        stats_set("wall", wt);
+        stats_set("verifier", total_time.verifier);
+        stats_set("peak_arena", mem.peak);
+        stats_set("arena_size", mem.size);
+        stats_write(report_path);
+    }
+
+    delete[] header;
+    for (int i=0; i<layers.size(); i++)
+        delete layers[i];
+    arena_destroy(&mem);
+    arena_destroy(&net_mem);
+    if (model_path)
+        model_close(&mf);
+
+    threadpool_shutdown();
+
+    return 0;
+}